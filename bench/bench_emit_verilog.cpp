@@ -0,0 +1,84 @@
+// Verilog emission throughput against EMIT_TARGET_GB_PER_S.
+//
+//   bench_emit_verilog [-l LIBRARY] [-i NETLIST | -n NETS] [-o FILE]
+//
+// Emits NETLIST (JSON or .fzn; default a synthetic LUT chain of NETS nets,
+// 1M) five times to a sink that drops the text, which measures formatting
+// alone, and five times to FILE (default a temporary file, removed after).
+// Reports the best run of each. Exits 1 if writing to the file misses the
+// target.
+
+#include "chain_netlist.hpp"
+#include "netlist_file.hpp"
+#include "verilog_text.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <streambuf>
+#include <string>
+
+namespace {
+
+constexpr int RUNS = 5;
+
+struct NullBuffer : std::streambuf {
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    int             overflow(int c) override { return c; }
+};
+
+}
+
+int main(int argc, char** argv) {
+    std::string library_source = "builtin:xilinx";
+    std::string input;
+    std::string output;
+    std::size_t nets = 1000000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string flag = argv[i];
+        if      (flag == "-l") library_source = argv[i + 1];
+        else if (flag == "-i") input          = argv[i + 1];
+        else if (flag == "-o") output         = argv[i + 1];
+        else if (flag == "-n") nets           = std::stoull(argv[i + 1]);
+    }
+
+    const bool temporary = output.empty();
+    if (temporary) output = (std::filesystem::temp_directory_path() / "fuznet_bench_emit.v").string();
+
+    const Library  library(library_source);
+    CompactNetlist netlist = input.empty() ? CompactNetlist::from_json(chain_netlist(nets), library)
+                                           : NetlistFile::load(input, library).current;
+
+    double formatting = 1e30, writing = 1e30;
+    for (int i = 0; i < RUNS; ++i) {
+        NullBuffer   sink;
+        std::ostream null_stream(&sink);
+        const auto   start = std::chrono::steady_clock::now();
+        netlist.emit_verilog(null_stream, "top");
+        formatting = std::min(formatting, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    for (int i = 0; i < RUNS; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::ofstream file(output, std::ios::trunc);
+            netlist.emit_verilog(file, "top");
+        }
+        writing = std::min(writing, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    const std::uintmax_t bytes = std::filesystem::file_size(output);
+    if (temporary) std::remove(output.c_str());
+
+    const double to_file = static_cast<double>(bytes) / writing / 1e9;
+    std::cout << std::fixed << std::setprecision(3)
+              << "modules     " << netlist.module_count() << '\n'
+              << "bytes       " << bytes << '\n'
+              << "formatting  " << formatting * 1e3 << " ms  " << static_cast<double>(bytes) / formatting / 1e9 << " GB/s\n"
+              << "to file     " << writing * 1e3 << " ms  " << to_file << " GB/s\n"
+              << "target      " << EMIT_TARGET_GB_PER_S << " GB/s to file: " << (to_file >= EMIT_TARGET_GB_PER_S ? "met" : "MISSED") << '\n';
+    return to_file >= EMIT_TARGET_GB_PER_S ? 0 : 1;
+}
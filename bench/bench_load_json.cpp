@@ -0,0 +1,77 @@
+// Netlist load time from JSON, by netlist size.
+//
+//   bench_load_json [-l LIBRARY] [NETS...]     (default 10000 100000 1000000)
+//
+// For each size, times Netlist::load_from_json on a parsed document and
+// NetlistFile::load of the same netlist saved to a file then Netlist::load,
+// the path reduce takes. Best of three runs.
+
+#include "chain_netlist.hpp"
+#include "netlist.hpp"
+#include "netlist_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int RUNS = 3;
+
+template <typename F>
+double best_seconds(F&& run) {
+    double best = 1e30;
+    for (int i = 0; i < RUNS; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::string              library_source = "builtin:xilinx";
+    std::vector<std::size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-l" && i + 1 < argc) library_source = argv[++i];
+        else sizes.push_back(std::stoull(arg));
+    }
+    if (sizes.empty()) sizes = {10000, 100000, 1000000};
+
+    const Library   library(library_source);
+    std::mt19937_64 rng(1);
+    const auto      path = (std::filesystem::temp_directory_path() / "fuznet_bench_load.json").string();
+
+    std::cout << std::setw(10) << "nets" << std::setw(18) << "load_from_json s" << std::setw(18) << "file load s" << '\n';
+    for (std::size_t nets : sizes) {
+        nlohmann::json document = {{"new", chain_netlist(nets)}};
+        {
+            std::ofstream out(path, std::ios::trunc);
+            out << document;
+        }
+
+        const double from_document = best_seconds([&] {
+            Netlist netlist(library, rng);
+            netlist.load_from_json(document["new"]);
+        });
+        const double from_file = best_seconds([&] {
+            Netlist netlist(library, rng);
+            netlist.load(NetlistFile::load(path, library).current);
+        });
+
+        std::cout << std::setw(10) << document["new"]["nets"].size()
+                  << std::setw(18) << std::fixed << std::setprecision(3) << from_document
+                  << std::setw(18) << from_file << '\n';
+    }
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// A netlist in the JSON form generate writes, of about `nets` nets: an IBUF
+// feeding a chain of LUT2s, each reading the two before it, into an OBUF.
+// Big enough inputs for the benchmarks without running the generator.
+inline nlohmann::json chain_netlist(std::size_t nets) {
+    nlohmann::json net_list    = nlohmann::json::array();
+    nlohmann::json module_list = nlohmann::json::array();
+    int            next_id     = 1;
+
+    auto add_net = [&](int type) {
+        const int id = next_id++;
+        net_list.push_back({{"id", id}, {"name", ""}, {"type", type}});
+        return id;
+    };
+    auto add_module = [&](const char* name, const std::vector<std::pair<const char*, std::pair<int, int>>>& ports,
+                          nlohmann::json params) {
+        nlohmann::json port_map = nlohmann::json::object();
+        for (const auto& [port, connection] : ports)
+            port_map[port] = {{"width", 1}, {"net_type", connection.first}, {"net_ids", {connection.second}}};
+        module_list.push_back({{"id", next_id++}, {"name", name}, {"ports", port_map}, {"params", params}});
+    };
+
+    // NetType: 2 EXT_IN, 3 EXT_OUT, 4 LOGIC
+    const int in  = add_net(2);
+    const int buf = add_net(4);
+    add_module("IBUF", {{"I", {2, in}}, {"O", {4, buf}}}, nlohmann::json::object());
+
+    int last = buf, before = buf;
+    while (net_list.size() + 2 < nets) {
+        const int out = add_net(4);
+        add_module("LUT2", {{"I0", {4, last}}, {"I1", {4, before}}, {"O", {4, out}}}, {{"INIT", "1001"}});
+        before = last;
+        last   = out;
+    }
+
+    const int pad = add_net(3);
+    add_module("OBUF", {{"I", {4, last}}, {"O", {3, pad}}}, nlohmann::json::object());
+
+    return {{"version", "0.1"}, {"nets", net_list}, {"modules", module_list}};
+}
@@ -9,12 +9,20 @@ run_gen() {
 
     info "Generating fuzzed netlist with fuznet"
 
+    local feedback=()
+    if (( ${USE_FEEDBACK:-0} )) && [[ -s ${FEEDBACK_FILE:-} ]]; then
+        feedback=(--feedback "$FEEDBACK_FILE")
+    fi
+
+    # The trace names the library, so record one that outlives OUT_DIR
     if "$FUZNET_BIN"  generate                     \
-                      -l "$CELL_LIB"               \
+                      -l "${CELL_LIB_SOURCE:-$CELL_LIB}" \
                       -c "$SETTINGS_TOML"          \
                       -s "$SEED"                   \
                       -v                           \
                       -j                           \
+                      --trace                      \
+                      "${feedback[@]}"             \
                       -o "$out/$fuzed_top"         \
                       >"$log_dir/fuznet.log" 2>&1;
     then
@@ -9,6 +9,17 @@ run_struct() {
     local log_dir=${4:-"$out/logs"}
 
     info "Running Structural equivalence check"
+
+    # Most designs match structurally; fuznet shows that without starting
+    # Yosys, and only what it cannot match goes on to equiv_struct
+    if "$FUZNET_BIN" -l "$CELL_LIB" struct-check                        \
+                     --gold "$out/$synth_top.v" --gold-top "$synth_top"  \
+                     --gate "$out/$impl_top.v"  --gate-top "$impl_top"   \
+                     > "$log_dir/struct_fuznet.log" 2>&1; then
+        pass "Structural equivalence check passed (fuznet)"
+        return 0
+    fi
+
     local yosys_script="$out/struct_check.ys"
     local template="flows/yosys/struct.ys.in"
 
@@ -1,6 +1,58 @@
 #!/usr/bin/env bash
 # Arguments:  out_dir  fuzzed_netlist_json  verilator_run_log  last_reduction_successful  [fuzzed_top]  [log_dir]
 # Returns:  0 on success, 1 on failure, 2 if no new bugs found, 3 if new bug found
+#
+# With USE_FUZNET_SERVE=1 every call of a run goes to one `fuznet serve`
+# process, started by the first, which keeps the netlist loaded between steps;
+# fuzzed_netlist_json is only read by that first call.
+
+# Sends request $1 to the reduction server; its reply's words in SERVE_REPLY
+serve_request() {
+    local reply
+    echo "$1" >&"${FUZNET_SERVER[1]}" || return 1
+    read -r reply <&"${FUZNET_SERVER[0]}" || return 1
+    read -r -a SERVE_REPLY <<< "$reply"
+    [[ ${SERVE_REPLY[0]} == ok ]] || { info "fuznet serve: $1: $reply"; return 1; }
+}
+
+# Arguments and return code as run_reduction, the net to keep instead of the log
+run_served_reduction() {
+    local out=$1
+    local fuzzed_netlist_json=$2
+    local wire_to_keep=$3
+    local last_reduction_successful=$4
+    local reset=$5
+    local fuzzed_top=$6
+    local log_dir=$7
+    local net=""
+
+    if [[ ! -v FUZNET_SERVER_PID ]]; then
+        local strategy=()
+        if (( ${USE_DDMIN:-0} )); then
+            strategy=(--ddmin)
+        fi
+        coproc FUZNET_SERVER {
+            "$FUZNET_BIN" -l "$CELL_LIB" -s "$SEED" -j -v serve --fzn --hash-file "$HASH_FILE" "${strategy[@]}" \
+                2>> "$log_dir/fuznet_reduction.log"
+        }
+        serve_request "load $fuzzed_netlist_json" || return 1
+        net=$wire_to_keep
+    fi
+
+    if (( last_reduction_successful )); then
+        serve_request accept || return 1
+    else
+        serve_request reject || return 1
+    fi
+    if (( reset )); then
+        serve_request reset || return 1
+    fi
+
+    serve_request "step $net" || return 1
+    local code=${SERVE_REPLY[1]}
+    serve_request "emit $out/$fuzzed_top netlist verilog stats" || return 1
+    return "$code"
+}
 
 run_reduction() {
     local out=$1
@@ -28,6 +80,7 @@ run_reduction() {
         -o "$out/$fuzzed_top"
         -j
         -v
+        --fzn
         --hash-file "$HASH_FILE"
     )
 
@@ -38,11 +91,20 @@ run_reduction() {
     if (( reset )); then
         args+=("--reset")
     fi
+    if (( ${USE_DDMIN:-0} )); then
+        args+=("--ddmin")
+    fi
 
     fuznet_ret=0
-    "$FUZNET_BIN"  "${args[@]}" \
-                    >> "$log_dir/fuznet_reduction.log" 2>&1 \
-                    || fuznet_ret=$?
+    if (( ${USE_FUZNET_SERVE:-0} )); then
+        run_served_reduction "$out" "$fuzzed_netlist_json" "$wire_to_keep" \
+                             "$last_reduction_successful" "$reset" "$fuzzed_top" "$log_dir" \
+                             || fuznet_ret=$?
+    else
+        "$FUZNET_BIN"  "${args[@]}" \
+                        >> "$log_dir/fuznet_reduction.log" 2>&1 \
+                        || fuznet_ret=$?
+    fi
     
     if (( fuznet_ret == 0 )); then
         info "fuznet reduction completed successfully"
@@ -18,4 +18,23 @@ export MAX_REDUCTION_ITER=${MAX_REDUCTION_ITER:-100}
 export CELL_LIB=${CELL_LIB:-hardware/xilinx/cells.yaml}
 
 export FUZNET_BIN=${FUZNET_BIN:-fuznet}
-export SETTINGS_TOML=${SETTINGS_TOML:-config/settings.toml}
\ No newline at end of file
+export SETTINGS_TOML=${SETTINGS_TOML:-config/settings.toml}
+# ───── result cache ───────────────────────────────────────────
+# Outcomes keyed by structural fingerprint and clock period, one small file
+# per key in $RESULT_CACHE_DIR. Written by rename, so a worker reading a key
+# another is writing sees all of it or nothing. Different designs can share
+# a fingerprint (see structural_hash.hpp), so a hit may skip a design that
+# never ran.
+
+cache_get() {
+    local file="$RESULT_CACHE_DIR/$1"
+    [[ -f $file ]] && cat "$file"
+}
+
+cache_put() {
+    mkdir -p "$RESULT_CACHE_DIR"
+    local tmp
+    tmp=$(mktemp "$RESULT_CACHE_DIR/.$1.XXXXXX")
+    printf '%s\n' "$2" > "$tmp"
+    mv -f "$tmp" "$RESULT_CACHE_DIR/$1"
+}
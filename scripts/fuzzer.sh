@@ -26,6 +26,10 @@ IMPL_TOP=${IMPL_TOP:-impl}  # gate-level hierarchy root
 FUZZED_TOP="fuzzed_netlist"       # basename (no .v)
 
 USE_SMTBMC=${USE_SMTBMC:-0}       # 1 → run BMC + induction
+USE_FEEDBACK=${USE_FEEDBACK:-0}   # 1 → weight generation by the campaign's feedback
+USE_RESULT_CACHE=${USE_RESULT_CACHE:-0}  # 1 → skip designs whose fingerprint already ran (off: fingerprints collide)
+USE_FUZNET_SERVE=${USE_FUZNET_SERVE:-0}  # 1 → reduce in one resident fuznet serve process (other removals than per-step)
+USE_DDMIN=${USE_DDMIN:-0}         # 1 → reduce by removing halving chunks of modules (ddmin), in another order
 
 clk_period=${CLK_PERIOD:-10.000}  # initial clock period constraint (ns)
 
@@ -46,11 +50,21 @@ PERMANENT_LOGS=${PERMANENT_LOGS:-logs}
 # ───── result bookkeeping & traps ─────────────────────────────────────────
 RESULT_CATEGORY=""
 
+# The library as given, for the trace: the copy below goes with OUT_DIR
+CELL_LIB_SOURCE=$CELL_LIB
+if [[ -f $CELL_LIB ]]; then
+    CELL_LIB_SOURCE=$(realpath "$CELL_LIB")
+fi
+export CELL_LIB_SOURCE
+
 cp $CELL_LIB $VIVADO_TCL $SETTINGS_TOML "$OUT_DIR/" 2>/dev/null || true
 export CELL_LIB="$OUT_DIR/$(basename "$CELL_LIB")"
 export VIVADO_TCL="$OUT_DIR/$(basename "$VIVADO_TCL")"
 export SETTINGS_TOML="$OUT_DIR/$(basename "$SETTINGS_TOML")"
-export HASH_FILE="${PERMANENT_LOGS}/seen_netlists.txt"
+export HASH_FILE="${PERMANENT_LOGS}/seen_netlists.db"
+export FEEDBACK_FILE="${PERMANENT_LOGS}/feedback.jsonl"
+export RESULT_CACHE_DIR="${PERMANENT_LOGS}/result_cache"
+CACHE_KEY=""                      # set once the design's fingerprint is known
 
 on_exit() {
     local end_time=$(date +%s%6N)
@@ -152,6 +166,24 @@ EOF
 
     echo "$result_line" >> "$results_csv"
 
+    # One line per design for generate --feedback, see src/orchestrator/feedback.hpp
+    if [[ -f $stats_json ]]; then
+        local vivado_micro=$(( ${STAGE_TIMES[run_impl]:-0} + ${STAGE_TIMES[run_impl_reduced]:-0} ))
+        jq -c --arg result "${RESULT_CATEGORY:-unknown}" \
+              --argjson vivado_seconds "$(( vivado_micro / 1000000 ))" \
+              '{result: $result, vivado_seconds: $vivado_seconds,
+                commands: .commands, primitives: .netlist_stats.primitives}' \
+              "$stats_json" >> "$FEEDBACK_FILE"
+    fi
+
+    # Outcomes a rerun of the same structure would repeat
+    if [[ -n $CACHE_KEY ]]; then
+        case ${RESULT_CATEGORY:-} in
+            ""|unknown|cached_*|driver_error|fuznet_fail|*timeout*) ;;
+            *) cache_put "$CACHE_KEY" "$RESULT_CATEGORY" ;;
+        esac
+    fi
+
 
     rm -rf "$OUT_DIR" || true
 }
@@ -185,6 +217,7 @@ capture_failed_seed() {
 
 sigint_handler() {
     echo "Caught SIGINT or SIGTERM, exiting..."
+    CACHE_KEY=""
     rm -rf "$OUT_DIR" 2>/dev/null || true
     exit 1
 }
@@ -206,6 +239,20 @@ if ! time_stage run_gen "$OUT_DIR" "$FUZZED_TOP" "$LOG_DIR"; then
     capture_failed_seed "fuznet failed"
     exit 1
 fi
+
+# ───── result cache ───────────────────────────────────────────
+if (( USE_RESULT_CACHE )); then
+    fingerprint=$(jq -r '.netlist_stats.fingerprint // empty' "$OUT_DIR/${FUZZED_TOP}_stats.json")
+    if [[ -n $fingerprint ]]; then
+        CACHE_KEY="${fingerprint}_${clk_period}"
+        if cached=$(cache_get "$CACHE_KEY"); then
+            RESULT_CATEGORY="cached_$cached"
+            info "same structure already ran at $clk_period ns: $cached"
+            exit 0
+        fi
+    fi
+fi
+
 # ───── stage 20 – Vivado PnR ──────────────────────────────────
 impl_ret=0
 time_stage run_impl "$OUT_DIR" "$SYNTH_TOP" "$IMPL_TOP" "$clk_period" "$FUZZED_TOP" "$LOG_DIR" || impl_ret=$?
@@ -296,7 +343,7 @@ while true; do
                     "$reduction_log_dir" || reduction_ret=$?
     reset=0
                 
-    reduction_src_json="$reduction_out_dir/$FUZZED_TOP.json"
+    reduction_src_json="$reduction_out_dir/$FUZZED_TOP.fzn"
 
     wns=$(scripts/get_wns_before_marker.py "$LOG_DIR/vivado.log")
     reduced_netlist_size=$(jq '.total_modules' "$reduction_out_dir/${FUZZED_TOP}_stats.json")
@@ -325,34 +372,51 @@ while true; do
             ;;
     esac
 
-    # ───── Rerun Vivado on reduced netlist ─────────────────────────────
-    vivado_ret=0
-    time_stage run_impl "$reduction_out_dir" "$SYNTH_TOP" "$IMPL_TOP" "$clk_period" "$FUZZED_TOP" "$reduction_log_dir" || vivado_ret=$?
+    # ───── same reduced structure already checked? ─────────────────────
+    step_key=""
+    if (( USE_RESULT_CACHE )); then
+        step_fingerprint=$(jq -r '.fingerprint // empty' "$reduction_out_dir/${FUZZED_TOP}_stats.json")
+        if [[ -n $step_fingerprint ]]; then
+            step_key="${step_fingerprint}_${clk_period}.step"
+        fi
+    fi
 
+    if [[ -n $step_key ]] && cached=$(cache_get "$step_key"); then
+        info "reduced structure already checked at $clk_period ns"
+        reduction_success=$cached
+    else
+        # ───── Rerun Vivado on reduced netlist ─────────────────────────────
+        vivado_ret=0
+        time_stage run_impl "$reduction_out_dir" "$SYNTH_TOP" "$IMPL_TOP" "$clk_period" "$FUZZED_TOP" "$reduction_log_dir" || vivado_ret=$?
 
-    # ───── check if reduction was successful ───────────────────────────
-    reduction_success=1
-    if (( vivado_ret == 0 )); then
-        miter_ret=0
-        time_stage run_miter "$reduction_out_dir" "$SYNTH_TOP" "$IMPL_TOP" "$LOG_DIR" || miter_ret=$?
+        # ───── check if reduction was successful ───────────────────────────
+        reduction_success=1
+        if (( vivado_ret == 0 )); then
+            miter_ret=0
+            time_stage run_miter "$reduction_out_dir" "$SYNTH_TOP" "$IMPL_TOP" "$LOG_DIR" || miter_ret=$?
 
-        if (( miter_ret != 1 )); then
-            verilator_ret=0
-            time_stage run_verilator "$reduction_out_dir" "$SYNTH_TOP" "$IMPL_TOP" "$LOG_DIR" || verilator_ret=$?
+            if (( miter_ret != 1 )); then
+                verilator_ret=0
+                time_stage run_verilator "$reduction_out_dir" "$SYNTH_TOP" "$IMPL_TOP" "$LOG_DIR" || verilator_ret=$?
+
+                if (( verilator_ret != 1 )); then
+                    reduction_success=0
+                fi
 
-            if (( verilator_ret != 1 )); then
-                reduction_success=0
             fi
+        elif (( vivado_ret == 1 )); then
+            RESULT_CATEGORY="vivado_fail_reduced"
+            capture_failed_seed "Vivado failed on reduced netlist" "rare"
+            exit 1
+        elif (( vivado_ret == 3 )); then
+            RESULT_CATEGORY="vivado_timeout_reduced"
+            capture_failed_seed "Vivado timed out on reduced netlist" "rare"
+            exit 1
+        fi
 
+        if [[ -n $step_key ]] && (( vivado_ret == 0 )); then
+            cache_put "$step_key" "$reduction_success"
         fi
-    elif (( vivado_ret == 1 )); then
-        RESULT_CATEGORY="vivado_fail_reduced"
-        capture_failed_seed "Vivado failed on reduced netlist" "rare"
-        exit 1
-    elif (( vivado_ret == 3 )); then
-        RESULT_CATEGORY="vivado_timeout_reduced"
-        capture_failed_seed "Vivado timed out on reduced netlist" "rare"
-        exit 1
     fi
 
     reduction_iterations=$(( reduction_iterations + 1 ))
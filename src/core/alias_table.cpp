@@ -0,0 +1,49 @@
+#include "alias_table.hpp"
+
+#include <numeric>
+
+// Vose's construction: columns below the mean weight are topped up from one
+// above it, which then keeps whatever it has left over.
+AliasTable::AliasTable(const std::vector<double>& weights) {
+    const std::size_t n     = weights.size();
+    const double      total = std::accumulate(weights.begin(), weights.end(), 0.0);
+    if (n == 0) return;
+
+    prob.resize(n);
+    alias.resize(n);
+
+    std::vector<double>      scaled(n);
+    std::vector<std::size_t> small;
+    std::vector<std::size_t> large;
+
+    for (std::size_t i = 0; i < n; ++i) {
+        scaled[i] = total > 0.0 ? weights[i] * static_cast<double>(n) / total : 1.0;
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+
+    while (!small.empty() && !large.empty()) {
+        const std::size_t s = small.back(); small.pop_back();
+        const std::size_t l = large.back();
+
+        prob[s]  = scaled[s];
+        alias[s] = l;
+
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // Whatever is left is 1 up to rounding
+    for (std::size_t i : large) { prob[i] = 1.0; alias[i] = i; }
+    for (std::size_t i : small) { prob[i] = 1.0; alias[i] = i; }
+}
+
+std::size_t AliasTable::sample(std::mt19937_64& rng) const {
+    std::uniform_int_distribution<std::size_t> column(0, prob.size() - 1);
+    std::uniform_real_distribution<double>     coin(0.0, 1.0);
+
+    const std::size_t i = column(rng);
+    return coin(rng) < prob[i] ? i : alias[i];
+}
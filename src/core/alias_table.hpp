@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+// Walker's alias method: weighted sampling in O(1) per draw after O(n) setup.
+// Entries with zero weight are never drawn, unless every weight is zero
+// in which case the draw is uniform (a lone zero-weight buffer still gets
+// picked).
+class AliasTable {
+public:
+    AliasTable() = default;
+    explicit AliasTable(const std::vector<double>& weights);
+
+    bool        empty() const { return prob.empty(); }
+    std::size_t size () const { return prob.size(); }
+
+    std::size_t sample(std::mt19937_64& rng) const;
+
+private:
+    std::vector<double>      prob;
+    std::vector<std::size_t> alias;
+};
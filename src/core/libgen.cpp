@@ -0,0 +1,155 @@
+// fuznet_libgen: compiles library YAMLs into the builtin library tables.
+//
+//   fuznet_libgen OUT.cpp NAME=LIBRARY.yaml [NAME=LIBRARY.yaml ...]
+//
+// OUT.cpp defines builtin_libraries() from library_data.hpp, with each YAML
+// available to Library as "builtin:NAME".
+
+#include "library_yaml.hpp"
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string literal(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + '"';
+}
+
+const char* dir_name(PortDir dir) {
+    return dir == PortDir::INPUT ? "PortDir::INPUT" : "PortDir::OUTPUT";
+}
+
+const char* type_name(NetType type) {
+    switch (type) {
+        case NetType::EXT_CLK: return "NetType::EXT_CLK";
+        case NetType::CLK:     return "NetType::CLK";
+        case NetType::EXT_IN:  return "NetType::EXT_IN";
+        case NetType::EXT_OUT: return "NetType::EXT_OUT";
+        case NetType::LOGIC:   return "NetType::LOGIC";
+    }
+    throw std::runtime_error("Invalid net type");
+}
+
+// Arrays for one library, named <lib>_<module index>_<what> to stay valid
+// C++ whatever the module names are
+void emit_library(std::ostream& os, const std::string& lib, const std::vector<ModuleSpec>& specs) {
+    if (specs.empty())
+        throw std::runtime_error("Library has no modules: " + lib);
+
+    for (std::size_t m = 0; m < specs.size(); ++m) {
+        const ModuleSpec& spec   = specs[m];
+        const std::string prefix = lib + "_" + std::to_string(m);
+
+        for (std::size_t i = 0; i < spec.outputs.size(); ++i) {
+            auto it = spec.seq_conns.find(spec.outputs[i].name);
+            if (it == spec.seq_conns.end()) continue;
+            os << "constexpr const char* " << prefix << "_seq_" << i << "[] = {";
+            for (const auto& input : it->second) os << ' ' << literal(input) << ',';
+            os << " };\n";
+        }
+
+        // Library keeps inputs and outputs apart, so the YAML's interleaving
+        // of the two need not survive
+        if (!spec.inputs.empty() || !spec.outputs.empty()) {
+            os << "constexpr PortData " << prefix << "_ports[] = {\n";
+            for (const auto* ports : {&spec.inputs, &spec.outputs})
+                for (std::size_t i = 0; i < ports->size(); ++i) {
+                    const PortSpec& port = (*ports)[i];
+                    os << "    { " << literal(port.name) << ", " << dir_name(port.port_dir) << ", "
+                       << port.width << ", " << type_name(port.net_type) << ", ";
+                    if (ports == &spec.outputs && spec.seq_conns.contains(port.name))
+                        os << prefix << "_seq_" << i;
+                    else
+                        os << "{}";
+                    os << " },\n";
+                }
+            os << "};\n";
+        }
+
+        if (!spec.params.empty()) {
+            os << "constexpr ParamData " << prefix << "_params[] = {";
+            for (const ParamSpec& param : spec.params)
+                os << " { " << literal(param.name) << ", " << param.width << " },";
+            os << " };\n";
+        }
+        if (!spec.resource.empty()) {
+            os << "constexpr ResourceData " << prefix << "_resources[] = {";
+            for (const auto& [name, count] : spec.resource)
+                os << " { " << literal(name) << ", " << count << " },";
+            os << " };\n";
+        }
+    }
+
+    os << "\nconstexpr ModuleData " << lib << "_modules[] = {\n";
+    for (std::size_t m = 0; m < specs.size(); ++m) {
+        const ModuleSpec& spec   = specs[m];
+        const std::string prefix = lib + "_" + std::to_string(m);
+        os << "    { " << literal(spec.name) << ", " << spec.weight << ", "
+           << (spec.combinational ? "true" : "false") << ", "
+           << (spec.inputs.empty() && spec.outputs.empty() ? "{}" : prefix + "_ports") << ", "
+           << (spec.params.empty()   ? "{}" : prefix + "_params") << ", "
+           << (spec.resource.empty() ? "{}" : prefix + "_resources") << " },\n";
+    }
+    os << "};\n\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: fuznet_libgen OUT.cpp NAME=LIBRARY.yaml [NAME=LIBRARY.yaml ...]\n";
+        return 1;
+    }
+
+    try {
+        std::ostringstream body;
+        std::vector<std::string> names;
+
+        for (int i = 2; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const auto        eq  = arg.find('=');
+            if (eq == std::string::npos || eq == 0)
+                throw std::runtime_error("Expected NAME=LIBRARY.yaml, got: " + arg);
+
+            const std::string name = arg.substr(0, eq);
+            const std::string path = arg.substr(eq + 1);
+            for (char c : name)
+                if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_')
+                    throw std::runtime_error("Library name must be an identifier: " + name);
+
+            body << "// " << name << ": " << path << "\n\n";
+            emit_library(body, name, read_library_yaml(path));
+            names.push_back(name);
+        }
+
+        std::ofstream out(argv[1], std::ios::trunc);
+        if (!out.is_open())
+            throw std::runtime_error(std::string("Could not write: ") + argv[1]);
+
+        out << "// Generated by fuznet_libgen, do not edit.\n\n"
+            << "#include \"library_data.hpp\"\n\n"
+            << "namespace {\n\n"
+            << body.str()
+            << "constexpr LibraryData libraries[] = {\n";
+        for (const auto& name : names)
+            out << "    { " << literal(name) << ", " << name << "_modules },\n";
+        out << "};\n\n"
+            << "}\n\n"
+            << "std::span<const LibraryData> builtin_libraries() { return libraries; }\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
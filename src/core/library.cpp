@@ -1,78 +1,148 @@
-#include <yaml-cpp/yaml.h>
+#include <algorithm>
 #include <iostream>
 
 #include "library.hpp"
+#include "library_data.hpp"
+#include "library_yaml.hpp"
+#include "packed_param.hpp"
 
-Library::Library(const std::string& filename, std::mt19937_64& rng)
-    : rng(rng) {
-
-    YAML::Node root = YAML::LoadFile(filename);
-
-    for (const auto& node_pair : root) {
-        const std::string module_name = node_pair.first.as<std::string>();
-        const YAML::Node& module_node = node_pair.second;
-
-        ModuleSpec module_spec;
-        module_spec.name = module_name;
-
-        for (const auto& port_pair : module_node["ports"]) {
-            PortSpec port_spec;
-            port_spec.name = port_pair.first.as<std::string>();
-
-            const YAML::Node& port_node = port_pair.second;
-            const std::string dir_str   = port_node["dir"].as<std::string>();
-            const std::string type_str  = port_node["type"].as<std::string>("logic");
-
-            port_spec.width = port_node["width"].as<int>(1);
-
-            if      (type_str == "clk")      port_spec.net_type = NetType::CLK;
-            else if (type_str == "ext_clk")  port_spec.net_type = NetType::EXT_CLK;
-            else if (type_str == "ext_out")  port_spec.net_type = NetType::EXT_OUT;
-            else if (type_str == "ext_in")   port_spec.net_type = NetType::EXT_IN;
-            else if (type_str == "logic")    port_spec.net_type = NetType::LOGIC;
-            // At the moment, we treat these as logic nets
-            else if (type_str == "reset")    port_spec.net_type = NetType::LOGIC;
-            else if (type_str == "set")      port_spec.net_type = NetType::LOGIC;
-            else if (type_str == "enable")   port_spec.net_type = NetType::LOGIC;
-
-            else throw std::runtime_error("Invalid port type: " + type_str);
-
-            if (dir_str == "input") {
-                port_spec.port_dir = PortDir::INPUT;
-                module_spec.inputs.push_back(port_spec);
-            } else if (dir_str == "output") {
-                port_spec.port_dir = PortDir::OUTPUT;
-                module_spec.outputs.push_back(port_spec);
-                if (port_node["seq_inputs"]) {
-                    module_spec.combinational = false;
-                    const std::vector<std::string> seq_inputs =
-                        port_node["seq_inputs"].as<std::vector<std::string>>();
-                    for (const auto& seq_port_name : seq_inputs)
-                        module_spec.seq_conns[port_spec.name].insert(seq_port_name);
-                }
-
-            } else {
-                throw std::runtime_error("Invalid port direction: " + dir_str);
-            }
+namespace {
+
+void compile_layout(ModuleSpec& spec) {
+    if (spec.inputs.size() > 64)
+        throw std::runtime_error("Too many input ports on module: " + spec.name);
+
+    int pin = 0;
+    for (auto* ports : {&spec.inputs, &spec.outputs})
+        for (std::size_t i = 0; i < ports->size(); ++i) {
+            (*ports)[i].index  = static_cast<int>(i);
+            (*ports)[i].offset = pin;
+            pin += (*ports)[i].width;
         }
 
-        if (module_node["params"])
-            for (const auto& param_pair : module_node["params"]) {
-                ParamSpec param_spec;
-                param_spec.name  = param_pair.first.as<std::string>();
-                param_spec.width = param_pair.second["width"].as<int>();
-                module_spec.params.push_back(param_spec);
-            }
+    for (const auto& port : spec.inputs)
+        spec.input_bits += port.width;
+    spec.output_bits = pin - spec.input_bits;
+
+    for (auto& param : spec.params) {
+        param.offset      = spec.param_words;
+        spec.param_words += packed::word_count(param.width);
+    }
+
+    spec.seq_inputs.assign(spec.outputs.size(), 0);
+    for (const auto& [output_name, input_names] : spec.seq_conns) {
+        auto output = std::find_if(spec.outputs.begin(), spec.outputs.end(),
+                                   [&](const PortSpec& p) { return p.name == output_name; });
+        if (output == spec.outputs.end())
+            throw std::runtime_error("Sequential connection from non-existent output: " + output_name);
+        for (const auto& input_name : input_names) {
+            auto input = std::find_if(spec.inputs.begin(), spec.inputs.end(),
+                                      [&](const PortSpec& p) { return p.name == input_name; });
+            if (input == spec.inputs.end())
+                throw std::runtime_error("Sequential connection to non-existent input: " + input_name);
+            spec.seq_inputs[output->index] |= std::uint64_t{1} << input->index;
+        }
+    }
+}
+
+// FNV-1a over the fields fed to it, each ended so "ab","c" and "a","bc" differ
+class FieldHash {
+public:
+    void add(std::string_view text) {
+        for (char c : text) byte(static_cast<unsigned char>(c));
+        byte(0);
+    }
+    void add(long long value) { add(std::string_view(std::to_string(value))); }
+
+    std::uint64_t value() const { return h; }
+
+private:
+    void byte(unsigned char b) {
+        h ^= b;
+        h *= 0x100000001b3ULL;
+    }
+
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+};
 
-        for (const auto& res_pair : module_node["resources"])
-            module_spec.resource[res_pair.first.as<std::string>()] =
-                res_pair.second.as<int>();
+// The compiled tables only save parsing YAML: each load still builds the
+// ModuleSpecs, strings, maps and all, and compiles them as a YAML load does
+std::vector<ModuleSpec> builtin_specs(std::string_view name) {
+    auto libraries = builtin_libraries();
+    auto library   = std::find_if(libraries.begin(), libraries.end(),
+                                  [&](const LibraryData& l) { return l.name == name; });
+    if (library == libraries.end())
+        throw std::runtime_error("Unknown builtin library: " + std::string(name));
 
-        module_spec.weight = module_node["weight"].as<int>(1);
+    std::vector<ModuleSpec> specs;
+    for (const ModuleData& data : library->modules) {
+        ModuleSpec spec;
+        spec.name          = data.name;
+        spec.weight        = data.weight;
+        spec.combinational = data.combinational;
+
+        for (const PortData& port : data.ports) {
+            auto& ports = port.port_dir == PortDir::INPUT ? spec.inputs : spec.outputs;
+            ports.push_back(PortSpec{port.name, port.port_dir, port.width, port.net_type});
+            for (const char* input : port.seq_inputs)
+                spec.seq_conns[port.name].insert(input);
+        }
+        for (const ParamData& param : data.params)
+            spec.params.push_back(ParamSpec{param.name, param.width});
+        for (const ResourceData& resource : data.resources)
+            spec.resource[resource.name] = resource.count;
 
-        module_weights.push_back(module_spec.weight);
-        modules.emplace(module_name, module_spec);
-        module_names.push_back(module_name);
+        specs.push_back(std::move(spec));
+    }
+    return specs;
+}
+
+}
+
+Library::Library(const std::string& source, const std::map<std::string, int>& weights) {
+    std::vector<ModuleSpec> specs = source.starts_with(BUILTIN_PREFIX)
+                                  ? builtin_specs(source.substr(BUILTIN_PREFIX.size()))
+                                  : read_library_yaml(source);
+
+    for (ModuleSpec& spec : specs) {
+        compile_layout(spec);
+        module_names.push_back(spec.name);
+        modules.emplace(spec.name, std::move(spec));
+    }
+
+    for (const auto& [name, weight] : weights) {
+        auto it = modules.find(name);
+        if (it == modules.end())
+            throw std::runtime_error("Weight given for unknown module: " + name);
+        if (weight < 0)
+            throw std::runtime_error("Negative weight for module: " + name);
+        it->second.weight = weight;
+    }
+
+    any_module = make_choice(nullptr);
+
+    for (std::size_t in = 0; in < NET_TYPE_COUNT; ++in)
+        for (std::size_t out = 0; out < NET_TYPE_COUNT; ++out)
+            buffers[in][out] = make_choice([&](const ModuleSpec& ms) {
+                return ms.inputs.size() == 1 &&
+                       ms.outputs.size() == 1 &&
+                       ms.inputs[0].net_type == static_cast<NetType>(in) &&
+                       ms.outputs[0].net_type == static_cast<NetType>(out);
+            });
+
+    for (const auto& [name, spec] : modules) {
+        if (spec.outputs.size() != 1) continue;
+        const PortSpec& output = spec.outputs[0];
+        for (bool sequential : {false, true}) {
+            auto key = std::make_tuple(output.net_type, output.width, sequential);
+            if (drivers.contains(key)) continue;
+            drivers[key] = make_choice([&](const ModuleSpec& ms) {
+                return ms.outputs.size() == 1 &&
+                       ms.outputs[0].net_type == output.net_type &&
+                       ms.outputs[0].width == output.width &&
+                       !(sequential && ms.combinational);
+            });
+        }
     }
 }
 
@@ -82,38 +152,114 @@ const ModuleSpec& Library::get_module(const std::string& name) const {
     return it->second;
 }
 
-const ModuleSpec& Library::get_random_module(std::function<bool (const ModuleSpec& ms)> filter) const {
-    if(!filter) {
-        std::discrete_distribution<int> dist(module_weights.begin(), module_weights.end());
-        return get_module(module_names[dist(rng)]);
-    }
+const ModuleSpec& Library::Choice::pick(std::mt19937_64& rng) const {
+    if (table.empty())
+        throw std::runtime_error("No modules for requested net type");
+    return *specs[table.sample(rng)];
+}
 
-    std::vector<int>          weights;
-    std::vector<std::string>  names;
+Library::Choice Library::make_choice(const std::function<bool (const ModuleSpec& ms)>& filter) const {
+    Choice              choice;
+    std::vector<double> weights;
 
     for (const auto& name : module_names) {
         const ModuleSpec& spec = get_module(name);
-        if (filter(spec)) {
+        if (!filter || filter(spec)) {
+            choice.specs.push_back(&spec);
             weights.push_back(spec.weight);
-            names.push_back(name);
         }
     }
 
-    if (weights.empty())
+    choice.table = AliasTable(weights);
+    return choice;
+}
+
+// A filter given as a plain function is the same filter on every call, so
+// its table is built once. Anything else may capture state and is rebuilt.
+const ModuleSpec& Library::get_random_module(std::mt19937_64& rng, std::function<bool (const ModuleSpec& ms)> filter) const {
+    if (!filter)
+        return any_module.pick(rng);
+
+    if (const FilterFn* fn = filter.target<FilterFn>()) {
+        std::lock_guard<std::mutex> lock(filtered_mutex);
+        auto it = filtered.find(*fn);
+        if (it == filtered.end())
+            it = filtered.emplace(*fn, make_choice(filter)).first;
+        return it->second.pick(rng);
+    }
+
+    return make_choice(filter).pick(rng);
+}
+
+const ModuleSpec& Library::get_random_buffer(std::mt19937_64& rng, NetType input_type, NetType output_type) const {
+    return buffers[static_cast<std::size_t>(input_type)][static_cast<std::size_t>(output_type)].pick(rng);
+}
+
+// Single-output module driving a net of `output_type`, sequential ones only
+// if asked
+const ModuleSpec& Library::get_random_driver(std::mt19937_64& rng, NetType output_type, int width, bool sequential) const {
+    auto it = drivers.find({output_type, width, sequential});
+    if (it == drivers.end())
         throw std::runtime_error("No modules for requested net type");
+    return it->second.pick(rng);
+}
+
+const ModuleSpec* Library::try_random_driver(std::mt19937_64& rng, NetType output_type, int width, bool sequential,
+                                             const std::function<bool (const ModuleSpec& ms)>& filter) const {
+    auto it = drivers.find({output_type, width, sequential});
+    if (it == drivers.end())
+        return nullptr;
 
-    std::discrete_distribution<int> dist(weights.begin(), weights.end());
-    return get_module(names[dist(rng)]);
+    Choice              accepted;
+    std::vector<double> weights;
+    for (const ModuleSpec* spec : it->second.specs)
+        if (filter(*spec)) {
+            accepted.specs.push_back(spec);
+            weights.push_back(spec->weight);
+        }
+    if (accepted.specs.empty())
+        return nullptr;
+
+    accepted.table = AliasTable(weights);
+    return &accepted.pick(rng);
 }
 
-const ModuleSpec& Library::get_random_buffer(NetType input_type, NetType output_type) const {
-    auto filter = [&](const ModuleSpec& ms) {
-        return ms.inputs.size() == 1 &&
-               ms.outputs.size() == 1 &&
-               ms.inputs[0].net_type == input_type &&
-               ms.outputs[0].net_type == output_type;
-    };
-    return get_random_module(filter);
+std::map<std::string, int> Library::weights() const {
+    std::map<std::string, int> result;
+    for (const auto& [name, spec] : modules)
+        result[name] = spec.weight;
+    return result;
+}
+
+std::uint64_t Library::fingerprint() const {
+    FieldHash h;
+    for (const std::string& name : module_names) {
+        const ModuleSpec& spec = modules.at(name);
+        h.add(spec.name);
+        h.add(spec.weight);
+        h.add(spec.combinational);
+        for (const auto* ports : {&spec.inputs, &spec.outputs}) {
+            h.add(static_cast<long long>(ports->size()));
+            for (const PortSpec& port : *ports) {
+                h.add(port.name);
+                h.add(port.width);
+                h.add(static_cast<long long>(port.net_type));
+            }
+        }
+        for (std::uint64_t arcs : spec.seq_inputs)
+            h.add(static_cast<long long>(arcs));
+        h.add(static_cast<long long>(spec.params.size()));
+        for (const ParamSpec& param : spec.params) {
+            h.add(param.name);
+            h.add(param.width);
+        }
+        h.add(static_cast<long long>(spec.resource.size()));
+        for (const auto& [resource, count] : spec.resource) {
+            h.add(resource);
+            h.add(count);
+        }
+    }
+    return h.value();
 }
 
 void Library::print() const {
@@ -1,25 +1,69 @@
 #pragma once
 
+#include "alias_table.hpp"
 #include "module.hpp"
 
+#include <array>
 #include <random>
 #include <string>
+#include <string_view>
 #include <map>
+#include <mutex>
+#include <tuple>
 #include <vector>
 #include <functional>
 
+// Read-only once loaded, so one library can serve several threads. Random
+// picks draw from the caller's generator.
 class Library {
 public:
-    Library(const std::string& filename, std::mt19937_64& rng);
+    static constexpr std::string_view BUILTIN_PREFIX = "builtin:";
+
+    // `source` is a library YAML, or "builtin:<name>" for one compiled in.
+    // `weights` replaces the pick weight of the modules it names.
+    explicit Library(const std::string& source, const std::map<std::string, int>& weights = {});
 
     const ModuleSpec& get_module        (const std::string& name) const;
-    const ModuleSpec& get_random_module (std::function<bool (const ModuleSpec& ms)> filter = nullptr) const;
-    const ModuleSpec& get_random_buffer (NetType input_type, NetType output_type) const;
+    const ModuleSpec& get_random_module (std::mt19937_64& rng, std::function<bool (const ModuleSpec& ms)> filter = nullptr) const;
+    const ModuleSpec& get_random_buffer (std::mt19937_64& rng, NetType input_type, NetType output_type) const;
+    const ModuleSpec& get_random_driver (std::mt19937_64& rng, NetType output_type, int width, bool sequential) const;
+    // As get_random_driver, among the drivers `filter` accepts; nullptr if none
+    const ModuleSpec* try_random_driver (std::mt19937_64& rng, NetType output_type, int width, bool sequential,
+                                         const std::function<bool (const ModuleSpec& ms)>& filter) const;
     void              print() const;
 
+    // Pick weight of every module, by name
+    std::map<std::string, int> weights() const;
+
+    // Hash of everything generation reads from the library: each module's
+    // ports, parameters, sequential arcs, resources and weight, in the order
+    // the library lists them. Stable across builds and machines.
+    std::uint64_t fingerprint() const;
+
 private:
+    using FilterFn = bool (*)(const ModuleSpec&);
+
+    // Weighted pick among a fixed set of modules
+    struct Choice {
+        std::vector<const ModuleSpec*> specs;
+        AliasTable                     table;
+
+        const ModuleSpec& pick(std::mt19937_64& rng) const;
+    };
+
+    Choice make_choice(const std::function<bool (const ModuleSpec& ms)>& filter) const;
+
     std::map<std::string, ModuleSpec>           modules;
     std::vector<std::string>                    module_names;
-    std::vector<int>                            module_weights;
-    std::mt19937_64&                            rng;
+
+    // Precompiled for the selections the generator makes: every module,
+    // single-in single-out buffers by net types, and single-output drivers
+    // by (type, width, sequential only)
+    Choice                                                      any_module;
+    std::array<std::array<Choice, NET_TYPE_COUNT>, NET_TYPE_COUNT> buffers;
+    std::map<std::tuple<NetType, int, bool>, Choice>            drivers;
+
+    // Other filters that are plain functions, keyed by function pointer
+    mutable std::mutex                                          filtered_mutex;
+    mutable std::map<FilterFn, Choice>                          filtered;
 };
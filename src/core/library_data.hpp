@@ -0,0 +1,45 @@
+#pragma once
+
+#include "module.hpp"
+
+#include <span>
+#include <string_view>
+
+// A cell library as plain constant data, the form fuznet_libgen compiles a
+// library YAML into. Modules are in file order, which fixes the order of
+// random picks. Library copies these into ModuleSpecs when it loads, so a
+// builtin library skips YAML parsing but not building the specs.
+struct PortData {
+    const char*                    name;
+    PortDir                        port_dir;
+    int                            width;
+    NetType                        net_type;
+    std::span<const char* const>   seq_inputs;  // outputs only
+};
+
+struct ParamData {
+    const char* name;
+    int         width;
+};
+
+struct ResourceData {
+    const char* name;
+    int         count;
+};
+
+struct ModuleData {
+    const char*                    name;
+    int                            weight;
+    bool                           combinational;
+    std::span<const PortData>      ports;
+    std::span<const ParamData>     params;
+    std::span<const ResourceData>  resources;
+};
+
+struct LibraryData {
+    const char*                    name;
+    std::span<const ModuleData>    modules;
+};
+
+// Libraries compiled into the binary, selected with "builtin:<name>"
+std::span<const LibraryData> builtin_libraries();
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "module.hpp"
+
+#include <string>
+#include <vector>
+
+// Modules of a library YAML in file order, before their layout is compiled.
+// Shared by Library and fuznet_libgen so both read a file the same way.
+std::vector<ModuleSpec> read_library_yaml(const std::string& filename);
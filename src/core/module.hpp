@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <map>
@@ -9,16 +10,25 @@
 enum class PortDir { INPUT, OUTPUT };
 enum class NetType { EXT_CLK, CLK, EXT_IN, EXT_OUT, LOGIC };
 
+constexpr std::size_t NET_TYPE_COUNT = static_cast<std::size_t>(NetType::LOGIC) + 1;
+
+// Resource totals by name, in the units of a library's `resources`
+// annotations, e.g. { io: 1 }
+using ResourceCounts = std::map<std::string, int>;
+
 struct PortSpec {
     std::string name;
     PortDir     port_dir;
     int         width;
     NetType     net_type;
+    int         index{0};   // position among the module's inputs or outputs
+    int         offset{0};  // first pin, counting input bits then output bits
 };
 
 struct ParamSpec {
     std::string name;
     int         width;
+    int         offset{0};  // first word among the module's packed parameter words
 };
 
 struct ModuleSpec {
@@ -29,5 +39,22 @@ struct ModuleSpec {
     std::map<std::string, std::set<std::string>> seq_conns;
     bool                                         combinational{true};
     int                                          weight;
-    std::map<std::string, int>                   resource;
+    ResourceCounts                               resource;
+
+    // Layout compiled when the library is loaded
+    std::vector<std::uint64_t>                   seq_inputs;     // per output, bit i set if input i is a sequential arc to it
+    int                                          input_bits{0};
+    int                                          output_bits{0};
+    int                                          param_words{0};
+
+    bool is_seq_arc(int output, int input) const { return (seq_inputs[output] >> input) & 1; }
+
+    // One bit in, one bit out, at a port of the top: an IO buffer
+    bool is_buffer() const {
+        return inputs.size() == 1 && outputs.size() == 1 &&
+               inputs[0].width == 1 && outputs[0].width == 1 &&
+               (inputs[0].net_type == NetType::EXT_IN ||
+                inputs[0].net_type == NetType::EXT_CLK ||
+                outputs[0].net_type == NetType::EXT_OUT);
+    }
 };
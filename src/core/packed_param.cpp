@@ -0,0 +1,98 @@
+#include "packed_param.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+namespace packed {
+
+namespace {
+
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+int digit_value(char c, int base) {
+    int value = -1;
+    if      (c >= '0' && c <= '9') value = c - '0';
+    else if (c >= 'a' && c <= 'f') value = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F') value = c - 'A' + 10;
+    return value < base ? value : -1;
+}
+
+// Digits are read MSB first, each worth `bits` bits
+void parse_digits(std::string_view digits, int bits, int width, std::span<std::uint64_t> words,
+                  std::string_view text) {
+    const int base = 1 << bits;
+    if (digits.empty() || static_cast<int>(digits.size()) * bits > width + bits - 1)
+        throw std::runtime_error("Invalid parameter value: " + std::string(text));
+
+    int bit = static_cast<int>(digits.size()) * bits;
+    for (char c : digits) {
+        const int value = digit_value(c, base);
+        if (value < 0)
+            throw std::runtime_error("Invalid parameter value: " + std::string(text));
+        bit -= bits;
+        if (width - bit < bits && (value >> (width - bit)))
+            throw std::runtime_error("Parameter value wider than " + std::to_string(width) + " bits: " + std::string(text));
+        words[bit / 64] |= static_cast<std::uint64_t>(value) << (bit % 64);
+    }
+}
+
+}
+
+void randomize(std::span<std::uint64_t> words, int width, std::mt19937_64& rng) {
+    for (auto& word : words)
+        word = rng();
+    if (width % 64)
+        words.back() &= (std::uint64_t{1} << (width % 64)) - 1;
+}
+
+std::string to_binary(std::span<const std::uint64_t> words, int width) {
+    std::string text(width, '0');
+    for (int bit = 0; bit < width; ++bit)
+        if ((words[bit / 64] >> (bit % 64)) & 1)
+            text[width - 1 - bit] = '1';
+    return text;
+}
+
+std::string to_hex(std::span<const std::uint64_t> words, int width) {
+    const int digits = (width + 3) / 4;
+    std::string text = std::to_string(width) + "'h";
+    text.reserve(text.size() + digits);
+    for (int bit = (digits - 1) * 4; bit >= 0; bit -= 4)
+        text.push_back(HEX_DIGITS[(words[bit / 64] >> (bit % 64)) & 0xF]);
+    return text;
+}
+
+std::string to_json(std::span<const std::uint64_t> words, int width) {
+    return width <= 4 ? to_binary(words, width) : to_hex(words, width);
+}
+
+void parse(std::string_view text, int width, std::span<std::uint64_t> words) {
+    std::fill(words.begin(), words.end(), 0);
+
+    const auto tick = text.find('\'');
+    if (tick == std::string_view::npos) {
+        if (static_cast<int>(text.size()) != width)
+            throw std::runtime_error("Parameter width mismatch: expected " + std::to_string(width) +
+                                     " bits, got \"" + std::string(text) + "\"");
+        parse_digits(text, 1, width, words, text);
+        return;
+    }
+
+    int declared = -1;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + tick, declared);
+    if (ec != std::errc{} || end != text.data() + tick || tick + 1 >= text.size())
+        throw std::runtime_error("Invalid parameter value: " + std::string(text));
+    if (declared != width)
+        throw std::runtime_error("Parameter width mismatch: expected " + std::to_string(width) +
+                                 " bits, got \"" + std::string(text) + "\"");
+
+    const std::string_view digits = text.substr(tick + 2);
+    switch (text[tick + 1]) {
+        case 'h': case 'H': parse_digits(digits, 4, width, words, text); break;
+        case 'b': case 'B': parse_digits(digits, 1, width, words, text); break;
+        default: throw std::runtime_error("Invalid parameter value: " + std::string(text));
+    }
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Parameter values packed into 64-bit words: bit b of a value lives in
+// word b / 64 at position b % 64, and bits above the width are zero.
+namespace packed {
+
+constexpr int word_count(int width) { return (width + 63) / 64; }
+
+// One rng() draw per word
+void randomize(std::span<std::uint64_t> words, int width, std::mt19937_64& rng);
+
+// MSB first, as in a Verilog N'b literal
+std::string to_binary(std::span<const std::uint64_t> words, int width);
+
+// "N'hXX.."
+std::string to_hex(std::span<const std::uint64_t> words, int width);
+
+// The JSON encoding: bare binary up to 4 bits, where it is no longer than
+// hex and matches older files, "N'hXX.." above that
+std::string to_json(std::span<const std::uint64_t> words, int width);
+
+// Accepts "N'h..", "N'b.." and the bare N-character binary strings of older
+// JSON files
+void parse(std::string_view text, int width, std::span<std::uint64_t> words);
+
+}
@@ -1,10 +1,23 @@
 #include <CLI/CLI.hpp>
+#include <csignal>
+#include <ctime>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <optional>
 #include <random>
+#include <set>
+#include <stdexcept>
 
+#include "batch.hpp"
+#include "fingerprint_store.hpp"
 #include "orchestrator.hpp"
 #include "reducer.hpp"
+#include "server.hpp"
+#include "structural_hash.hpp"
+#include "struct_check.hpp"
+
+#include <unistd.h>
 
 int main(int argc, char** argv) {
     try {
@@ -12,22 +25,48 @@ int main(int argc, char** argv) {
 
         std::string lib_cfg      = "hardware/xilinx/cells.yaml";
         std::string settings_cfg = "config/settings.toml";
-        std::string hash_file    = "output/seen_netlists.txt";
+        std::string hash_file    = "output/seen_netlists.db";
         std::string out_prefix   = "output/output";
         std::string seed_str     = std::to_string(std::random_device{}());
+        std::string seed_start;
+        int         count        = 1;
+        int         threads      = 1;
+        long long   stream       = 0;
+        std::size_t frontier     = 65536;
 
         std::string json_netlist = "output/output_netlist.json";
         int         keep_only    = -1;
 
+        std::string convert_in;
+        std::string convert_out;
+        std::string fingerprint_in;
+
+        std::string gold_verilog;
+        std::string gate_verilog;
+        std::string gold_top;
+        std::string gate_top;
+
+        std::string      animation_log;
+        std::vector<int> render_steps;
+
         bool animate      = false;
         bool verbose      = false;
         bool show_ver     = false;
         bool json_stats   = false;
         bool last_success = false;
         bool reset        = false;
+        bool snapshot     = false;
+        bool trace        = false;
+        bool ddmin        = false;
+
+        std::string trace_file;
+        std::string feedback_file;
+        std::string socket_path;
 
+        std::vector<std::string> merge_sources;
 
-        app.add_option("-l,--lib",     lib_cfg,      "Cell library YAML");
+
+        app.add_option("-l,--lib",     lib_cfg,      "Cell library YAML, or builtin:<name> for one compiled in");
         app.add_option("-s,--seed",    seed_str,     "Random seed");
         app.add_flag  ("-v,--verbose", verbose,      "Print chosen options");
         app.add_flag  ("--version",    show_ver,     "Show version");
@@ -36,17 +75,66 @@ int main(int argc, char** argv) {
         app.fallthrough();
 
         auto generate_mode = app.add_subcommand("generate", "Generate a new netlist");
-        generate_mode->add_flag  ("-a,--animate", animate,      "Write DOT after each step");
+        generate_mode->add_flag  ("-a,--animate", animate,      "Record each step to <output>.anim, see render");
         generate_mode->add_option("-c,--config",  settings_cfg, "Settings TOML");
         generate_mode->add_option("-o,--output",  out_prefix,   "Output prefix");
+        generate_mode->add_flag  ("--fzn",        snapshot,     "Write a binary .fzn snapshot instead of JSON");
+        generate_mode->add_option("--count",      count,        "Netlists to generate, each to <output>_<seed>");
+        generate_mode->add_option("--seed-start", seed_start,   "Seed of the first netlist, the rest count up (default: --seed)");
+        generate_mode->add_option("--threads",    threads,      "Worker threads for a batch, output does not depend on it");
+        generate_mode->add_flag  ("--trace",      trace,        "Record <output>.trace, enough to rebuild the netlist with replay");
+        generate_mode->add_option("--stream",     stream,       "Stream a design of this many modules straight to Verilog, in bounded memory");
+        generate_mode->add_option("--frontier",   frontier,     "With --stream, recent nets per type kept to pick inputs from");
+        generate_mode->add_option("--feedback",   feedback_file, "Campaign feedback (JSON lines) to weight toward what found new bugs");
         
         auto reducer_mode = app.add_subcommand("reduce", "Reduce netlist to a single output net");
-        reducer_mode->add_option("-i,--input",     json_netlist, "Input JSON netlist")->required();
+        reducer_mode->add_option("-i,--input",     json_netlist, "Input netlist, JSON or .fzn snapshot")->required();
         reducer_mode->add_option("--hash-file",    hash_file,    "File to store seen netlists hashes")->required();
         reducer_mode->add_option("-o,--output",    out_prefix,   "Output prefix");
         reducer_mode->add_option("-r,--keep-only", keep_only,    "Keep only this outout net and remove othets");
         reducer_mode->add_flag  ("--last-success", last_success, "Flag if the last reduction iteration was a success");
         reducer_mode->add_flag  ("--reset",        reset,        "Reset the trialed primitives history");
+        reducer_mode->add_flag  ("--fzn",          snapshot,     "Write a binary .fzn snapshot instead of JSON");
+        reducer_mode->add_flag  ("--ddmin",        ddmin,        "Remove chunks of modules, halving them when none can go, not one at a time");
+
+        auto convert_mode = app.add_subcommand("convert", "Convert a netlist file between JSON and .fzn snapshot");
+        convert_mode->add_option("-i,--input",  convert_in,  "Input netlist, JSON or .fzn snapshot")->required();
+        convert_mode->add_option("-o,--output", convert_out, "Output file, a snapshot if it ends in .fzn")->required();
+
+        auto fingerprint_mode = app.add_subcommand("fingerprint", "Print the structural hash of a netlist file");
+        fingerprint_mode->add_option("-i,--input", fingerprint_in, "Netlist, JSON or .fzn snapshot")->required();
+
+        auto struct_mode = app.add_subcommand("struct-check", "Structurally compare two Vivado funcsim netlists");
+        struct_mode->add_option("--gold",     gold_verilog, "Gold netlist, e.g. synth.v")->required();
+        struct_mode->add_option("--gate",     gate_verilog, "Gate netlist, e.g. impl.v")->required();
+        struct_mode->add_option("--gold-top", gold_top,     "Top module of the gold netlist (default: first)");
+        struct_mode->add_option("--gate-top", gate_top,     "Top module of the gate netlist (default: first)");
+
+        auto render_mode = app.add_subcommand("render", "Render steps of a generate --animate log as DOT files");
+        render_mode->add_option("-i,--input",  animation_log, "Animation log (.anim)")->required();
+        render_mode->add_option("-o,--output", out_prefix,    "Output prefix, one <prefix>_iterN.dot per step");
+        render_mode->add_option("-n,--iter",   render_steps,  "Steps to render (default: all)");
+
+        auto replay_mode = app.add_subcommand("replay", "Rebuild a netlist from a generate --trace recording");
+        replay_mode->add_option("-i,--input",  trace_file, "Trace (.trace)")->required();
+        replay_mode->add_option("-o,--output", out_prefix, "Output prefix");
+        replay_mode->add_flag  ("--fzn",       snapshot,   "Write a binary .fzn snapshot instead of JSON");
+
+        auto hashdb_mode = app.add_subcommand("hashdb", "Inspect or maintain a reduce --hash-file fingerprint store");
+        hashdb_mode->add_option("-d,--db", hash_file, "Fingerprint store")->required();
+        hashdb_mode->require_subcommand(1);
+        hashdb_mode->fallthrough();
+        auto hashdb_list    = hashdb_mode->add_subcommand("list",    "Print each fingerprint and when it was added, oldest first");
+        auto hashdb_merge   = hashdb_mode->add_subcommand("merge",   "Add the fingerprints of other stores");
+        auto hashdb_compact = hashdb_mode->add_subcommand("compact", "Rebuild the store at the smallest size for its entries");
+        hashdb_merge->add_option("-i,--input", merge_sources, "Fingerprint store")->required();
+
+        auto serve_mode = app.add_subcommand("serve", "Answer generate and reduce requests line by line, keeping the library and netlist loaded");
+        serve_mode->add_option("--socket",    socket_path,  "Listen on this Unix socket instead of stdin and stdout");
+        serve_mode->add_option("-c,--config", settings_cfg, "Settings TOML, for generate requests");
+        serve_mode->add_option("--hash-file", hash_file,    "File to store seen netlists hashes");
+        serve_mode->add_flag  ("--fzn",       snapshot,     "Write a binary .fzn snapshot instead of JSON");
+        serve_mode->add_flag  ("--ddmin",     ddmin,        "Reduce as reduce --ddmin");
 
 
         CLI11_PARSE(app, argc, argv);
@@ -63,13 +151,137 @@ int main(int argc, char** argv) {
 
         unsigned seed = std::stoul(seed_str);
 
+        // A batch names each design after its seed; the files match what a
+        // single run with that seed writes
         if (*generate_mode) {
-            fuznet::Orchestrator orch(lib_cfg, settings_cfg, seed, verbose, animate, json_stats);
+            std::optional<fuznet::Feedback> feedback;
+            if (!feedback_file.empty()) {
+                feedback = fuznet::Feedback::load(feedback_file);
+                if (verbose) feedback->print();
+            }
+            const fuznet::Feedback* steer = feedback ? &*feedback : nullptr;
+
+            if (stream > 0) {
+                if (count != 1 || threads != 1 || !seed_start.empty() || animate || snapshot || trace)
+                    throw std::runtime_error("--stream writes one Verilog file, without --count, --threads, --animate, --fzn or --trace");
+                fuznet::Orchestrator orch(lib_cfg, settings_cfg, seed, verbose, false, json_stats, false, false, steer);
+                orch.run_stream(out_prefix, stream, frontier);
+            } else if (count != 1 || threads != 1 || !seed_start.empty()) {
+                const unsigned first = seed_start.empty() ? seed : static_cast<unsigned>(std::stoul(seed_start));
+                fuznet::Batch batch(lib_cfg, settings_cfg, verbose, animate, json_stats, snapshot, trace, steer);
+                batch.run(out_prefix, first, count, threads);
+            } else {
+                fuznet::Orchestrator orch(lib_cfg, settings_cfg, seed, verbose, animate, json_stats, snapshot, trace, steer);
+                orch.run(out_prefix);
+            }
+        }
+
+        // The same files generate wrote, from the trace's library unless -l
+        // names another
+        if (*replay_mode) {
+            fuznet::Trace recorded = fuznet::Trace::load(trace_file);
+            if (app.get_option("--lib")->count() > 0)
+                recorded.library = lib_cfg;
+            if (verbose)
+                std::cout << "replaying: seed " << recorded.seed << " on " << recorded.library << '\n';
+            fuznet::Orchestrator orch(recorded, verbose, json_stats, snapshot);
             orch.run(out_prefix);
         }
 
+        if (*hashdb_mode) {
+            const fuznet::FingerprintStore store(hash_file);
+
+            if (*hashdb_list)
+                for (const auto& entry : store.entries()) {
+                    std::cout << fingerprint_text(entry.fingerprint);
+                    if (entry.added) {
+                        const std::time_t added = entry.added;
+                        std::cout << '\t' << std::put_time(std::gmtime(&added), "%Y-%m-%dT%H:%M:%SZ");
+                    }
+                    std::cout << '\n';
+                }
+
+            if (*hashdb_merge)
+                for (const auto& source : merge_sources) {
+                    const std::size_t added = store.merge(source);
+                    if (verbose)
+                        std::cout << source << ": " << added << " new\n";
+                }
+
+            if (*hashdb_compact)
+                store.compact();
+
+            if (verbose && !*hashdb_list)
+                std::cout << hash_file << ": " << store.entries().size() << " fingerprints\n";
+        }
+
+        // The protocol is documented in server.hpp
+        if (*serve_mode) {
+            // A client that goes away ends its session, not the server
+            std::signal(SIGPIPE, SIG_IGN);
+            fuznet::Server server(lib_cfg, settings_cfg, hash_file, seed, verbose, json_stats, snapshot, ddmin);
+
+            if (!socket_path.empty()) {
+                server.listen(socket_path);
+            } else {
+                // Replies own stdout, reports go to stderr
+                std::streambuf* replies = std::cout.rdbuf(std::cerr.rdbuf());
+                server.serve(STDIN_FILENO, STDOUT_FILENO);
+                std::cout.rdbuf(replies);
+            }
+        }
+
+        if (*convert_mode) {
+            const Library     library(lib_cfg);
+            const NetlistFile file = NetlistFile::load(convert_in, library);
+
+            if (convert_out.ends_with(".fzn"))
+                file.save_snapshot(convert_out);
+            else
+                file.save_json(convert_out);
+        }
+
+        if (*fingerprint_mode) {
+            const Library     library(lib_cfg);
+            const NetlistFile file = NetlistFile::load(fingerprint_in, library);
+            std::cout << fingerprint_text(structural_hash(file.current)) << '\n';
+        }
+
+        if (*render_mode) {
+            const Library       library(lib_cfg);
+            const std::set<int> steps(render_steps.begin(), render_steps.end());
+
+            int       rendered = 0;
+            const int total    = AnimationLog::render(animation_log, library, steps, [&](int step, const CompactNetlist& frame) {
+                std::ofstream dot(out_prefix + "_iter" + std::to_string(step) + ".dot", std::ios::trunc);
+                frame.emit_dotfile(dot, "top");
+                ++rendered;
+            });
+            if (verbose)
+                std::cout << "Rendered " << rendered << " of " << total << " steps\n";
+        }
+
+        // 0 when the structures match; 1 when they do not, or a netlist is
+        // outside what the reader takes, and a full check has to decide
+        if (*struct_mode) {
+            const Library   library(lib_cfg);
+            const auto      gold = FuncsimNetlist::read(gold_verilog, library, gold_top);
+            const auto      gate = FuncsimNetlist::read(gate_verilog, library, gate_top);
+
+            const StructCheck check = StructCheck::run(gold, gate);
+            if (check.match) {
+                std::cout << "Structural match: " << gold.outputs.size() << " output bits\n";
+                return 0;
+            }
+            std::cout << "No structural match for " << check.unmatched.size() << " output bits:";
+            for (std::size_t i = 0; i < std::min<std::size_t>(check.unmatched.size(), 10); ++i)
+                std::cout << ' ' << check.unmatched[i];
+            std::cout << '\n';
+            return 1;
+        }
+
         if (*reducer_mode) {
-            fuznet::Reducer reducer(lib_cfg, json_netlist, hash_file, seed, json_stats, verbose);
+            fuznet::Reducer reducer(lib_cfg, json_netlist, hash_file, seed, json_stats, verbose, snapshot, ddmin);
             fuznet::Result result = reducer.reduce(keep_only, last_success, reset);
             reducer.write_outputs(out_prefix);
             
@@ -0,0 +1,282 @@
+#include "animation_log.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr char MAGIC[8] = {'F', 'Z', 'N', 'A', 'N', 'I', 'M', '\0'};
+
+enum Op : std::uint8_t { STEP, ADD_NET, ADD_MODULE, CONNECT, REMOVE_NET, REMOVE_MODULE, CLEAR, KIND };
+
+constexpr std::size_t FLUSH_SIZE = std::size_t{1} << 16;
+
+class Reader {
+public:
+    Reader(std::string_view data, const std::string& path) : data(data), path(path) {}
+
+    bool done() const { return pos >= data.size(); }
+
+    std::uint8_t byte() {
+        if (done()) truncated();
+        return static_cast<std::uint8_t>(data[pos++]);
+    }
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const std::uint8_t b = byte();
+            value |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return value;
+        }
+        throw std::runtime_error("Corrupt animation log: " + path);
+    }
+    std::uint64_t id() {
+        const std::uint64_t zigzag = varint();
+        last_id += static_cast<std::uint64_t>(static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1));
+        if (last_id >= CompactNetlist::NONE)
+            throw std::runtime_error("Corrupt animation log: " + path);
+        return last_id;
+    }
+    std::string_view text() {
+        const std::uint64_t size = varint();
+        if (size > data.size() - pos) truncated();
+        const std::string_view s = data.substr(pos, size);
+        pos += size;
+        return s;
+    }
+
+private:
+    [[noreturn]] void truncated() const { throw std::runtime_error("Truncated animation log: " + path); }
+
+    std::string_view   data;
+    const std::string& path;
+    std::size_t        pos{sizeof(MAGIC)};
+    std::uint64_t      last_id{0};
+};
+
+// The netlist as the log has built it so far. Removed objects stay in place,
+// marked dead, so the survivors keep their creation order as in Netlist.
+struct Replay {
+    struct Net {
+        std::uint32_t id;
+        NetType       type;
+        std::string   name;
+        bool          dead{false};
+    };
+    struct Module {
+        std::uint32_t              id;
+        const ModuleSpec*          spec;
+        std::vector<std::uint32_t> pins;  // net id per pin, 0 if open
+        bool                       dead{false};
+    };
+
+    std::vector<Net>           nets;
+    std::vector<Module>        modules;
+    std::vector<std::uint32_t> net_at;     // id -> position in nets + 1, 0 if none
+    std::vector<std::uint32_t> module_at;
+    std::uint32_t              next_id{1};
+
+    static void place(std::vector<std::uint32_t>& at, std::uint32_t id, std::size_t position) {
+        if (id >= at.size()) at.resize(std::max<std::size_t>(id + 1, at.size() * 2), 0);
+        at[id] = static_cast<std::uint32_t>(position + 1);
+    }
+    template <typename T>
+    static T* find(std::vector<T>& objects, const std::vector<std::uint32_t>& at, std::uint64_t id) {
+        if (id >= at.size() || !at[id]) return nullptr;
+        T& object = objects[at[id] - 1];
+        return object.dead ? nullptr : &object;
+    }
+
+    CompactNetlist snapshot() {
+        CompactNetlist::Builder builder;
+        std::vector<CompactNetlist::Index> by_id(next_id, CompactNetlist::NONE);
+
+        for (const Net& net : nets)
+            if (!net.dead)
+                by_id[net.id] = builder.add_net(net.id, net.type, net.name);
+
+        for (const Module& module : modules) {
+            if (module.dead) continue;
+            const auto index = builder.add_module(module.id, *module.spec);
+            for (std::size_t pin = 0; pin < module.pins.size(); ++pin)
+                if (module.pins[pin] && module.pins[pin] < next_id && by_id[module.pins[pin]] != CompactNetlist::NONE)
+                    builder.connect(builder.first_pin(index) + static_cast<CompactNetlist::Index>(pin), by_id[module.pins[pin]]);
+        }
+
+        builder.set_next_id(next_id);
+        return builder.finalize();
+    }
+};
+
+}
+
+void AnimationLog::open(const std::string& path) {
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Could not write animation log: " + path);
+
+    file.write(MAGIC, sizeof(MAGIC));
+    std::string pending;
+    pending.swap(buffer);
+    put_varint(VERSION);
+    buffer += pending;
+    flush();
+}
+
+// Records never written are dropped. The next file starts its own id
+// deltas and kind table.
+void AnimationLog::close() {
+    if (file.is_open()) {
+        flush();
+        file.close();
+    }
+    buffer.clear();
+    last_id = 0;
+    kinds.clear();
+}
+
+void AnimationLog::flush() {
+    if (!file.is_open()) return;
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+}
+
+void AnimationLog::put_varint(std::uint64_t value) {
+    while (value >= 0x80) {
+        put_byte(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    put_byte(static_cast<std::uint8_t>(value));
+}
+
+void AnimationLog::put_id(std::uint64_t id) {
+    const auto delta = static_cast<std::int64_t>(id - last_id);
+    put_varint((static_cast<std::uint64_t>(delta) << 1) ^ static_cast<std::uint64_t>(delta >> 63));
+    last_id = id;
+}
+
+void AnimationLog::add_net(std::uint64_t id, NetType type, std::string_view name) {
+    put_byte(ADD_NET);
+    put_id(id);
+    put_byte(static_cast<std::uint8_t>(type));
+    put_varint(name.size());
+    buffer += name;
+}
+
+void AnimationLog::add_module(std::uint64_t id, const ModuleSpec& spec) {
+    auto [kind, added] = kinds.try_emplace(&spec, static_cast<std::uint32_t>(kinds.size()));
+    if (added) {
+        put_byte(KIND);
+        put_varint(spec.name.size());
+        buffer += spec.name;
+    }
+    put_byte(ADD_MODULE);
+    put_id(id);
+    put_varint(kind->second);
+}
+
+void AnimationLog::connect(std::uint64_t module, int pin, std::uint64_t net) {
+    put_byte(CONNECT);
+    put_id(module);
+    put_varint(static_cast<std::uint64_t>(pin));
+    put_id(net);
+}
+
+void AnimationLog::remove_net(std::uint64_t id) {
+    put_byte(REMOVE_NET);
+    put_id(id);
+}
+
+void AnimationLog::remove_module(std::uint64_t id) {
+    put_byte(REMOVE_MODULE);
+    put_id(id);
+}
+
+void AnimationLog::clear() {
+    put_byte(CLEAR);
+}
+
+void AnimationLog::step() {
+    put_byte(STEP);
+    if (buffer.size() >= FLUSH_SIZE)
+        flush();
+}
+
+int AnimationLog::render(const std::string& path, const Library& lib, const std::set<int>& steps,
+                         const std::function<void(int, const CompactNetlist&)>& frame) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        throw std::runtime_error("Could not open animation log: " + path);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    const std::string data = contents.str();
+
+    if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error("Not an animation log: " + path);
+
+    Reader reader(data, path);
+    if (const auto version = reader.varint(); version != VERSION)
+        throw std::runtime_error("Unsupported animation log version " + std::to_string(version) + ": " + path);
+
+    auto corrupt = [&] { return std::runtime_error("Corrupt animation log: " + path); };
+
+    Replay                         state;
+    std::vector<const ModuleSpec*> kinds;
+    int                            step = 0;
+    while (!reader.done()) {
+        switch (reader.byte()) {
+            case STEP:
+                if (steps.empty() || steps.contains(step))
+                    frame(step, state.snapshot());
+                ++step;
+                break;
+            case KIND:
+                kinds.push_back(&lib.get_module(std::string(reader.text())));
+                break;
+            case ADD_NET: {
+                const auto id   = static_cast<std::uint32_t>(reader.id());
+                const auto type = reader.byte();
+                if (type >= NET_TYPE_COUNT) throw corrupt();
+                Replay::place(state.net_at, id, state.nets.size());
+                state.nets.push_back({id, static_cast<NetType>(type), std::string(reader.text())});
+                state.next_id = std::max(state.next_id, id + 1);
+                break;
+            }
+            case ADD_MODULE: {
+                const auto id   = static_cast<std::uint32_t>(reader.id());
+                const auto kind = reader.varint();
+                if (kind >= kinds.size()) throw corrupt();
+                Replay::place(state.module_at, id, state.modules.size());
+                state.modules.push_back({id, kinds[kind],
+                                         std::vector<std::uint32_t>(kinds[kind]->input_bits + kinds[kind]->output_bits, 0)});
+                state.next_id = std::max(state.next_id, id + 1);
+                break;
+            }
+            case CONNECT: {
+                const auto module = reader.id();
+                const auto pin    = reader.varint();
+                const auto net    = reader.id();
+                auto* m = Replay::find(state.modules, state.module_at, module);
+                if (!m || pin >= m->pins.size() || !Replay::find(state.nets, state.net_at, net)) throw corrupt();
+                m->pins[pin] = static_cast<std::uint32_t>(net);
+                break;
+            }
+            case REMOVE_NET:
+                if (auto* n = Replay::find(state.nets, state.net_at, reader.id())) n->dead = true;
+                break;
+            case REMOVE_MODULE:
+                if (auto* m = Replay::find(state.modules, state.module_at, reader.id())) m->dead = true;
+                break;
+            case CLEAR:
+                for (auto& n : state.nets)    n.dead = true;
+                for (auto& m : state.modules) m.dead = true;
+                break;
+            default:
+                throw corrupt();
+        }
+    }
+    return step;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "compact_netlist.hpp"
+#include "library.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Netlist edits recorded as they happen, so any step of a generation run can
+// be rendered afterwards without writing the whole graph at every step.
+//
+// The file is "FZNANIM\0", a version varint, then records: an opcode byte
+// followed by LEB128 varints. Ids are zigzag deltas from the previous id in
+// the stream, which keeps the common "next id" case to one byte. A module
+// kind is named once and referred to by index after that. Parameter values
+// are not recorded; the log carries structure only.
+class AnimationLog {
+public:
+    static constexpr std::uint32_t VERSION = 1;
+
+    AnimationLog() = default;
+    ~AnimationLog() { close(); }
+    AnimationLog(const AnimationLog&)            = delete;
+    AnimationLog& operator=(const AnimationLog&) = delete;
+
+    // Records made before open() are kept and written out first, those
+    // still unwritten at close() are dropped
+    void open (const std::string& path);
+    void close();
+
+    void add_net      (std::uint64_t id, NetType type, std::string_view name);
+    void add_module   (std::uint64_t id, const ModuleSpec& spec);
+    void connect      (std::uint64_t module, int pin, std::uint64_t net);
+    void remove_net   (std::uint64_t id);
+    void remove_module(std::uint64_t id);
+    void clear        ();
+    void step         ();
+
+    // Replays the log at `path` and hands `frame` the netlist as it stood
+    // at each step in `steps`, or at every step if `steps` is empty.
+    // Returns the number of steps in the log.
+    static int render(const std::string& path, const Library& lib, const std::set<int>& steps,
+                      const std::function<void(int, const CompactNetlist&)>& frame);
+
+private:
+    void put_byte  (std::uint8_t byte) { buffer.push_back(static_cast<char>(byte)); }
+    void put_varint(std::uint64_t value);
+    void put_id    (std::uint64_t id);
+    void flush     ();
+
+    std::string                                          buffer;
+    std::ofstream                                        file;
+    std::uint64_t                                        last_id{0};
+    std::unordered_map<const ModuleSpec*, std::uint32_t> kinds;
+};
@@ -0,0 +1,944 @@
+#include "compact_netlist.hpp"
+#include "packed_param.hpp"
+#include "verilog_text.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+std::string padded_id(std::uint32_t id, int width) {
+    int digit_count = static_cast<int>(std::log10(id)) + 1;
+    if (width < digit_count) throw std::invalid_argument("Width too small for ID");
+    return "_" + std::string(width - digit_count, '0') + std::to_string(id) + "_";
+}
+
+// A JSON string literal, escaped as nlohmann's dump() escapes it
+void put_json_string(OutputBuffer& out, std::string_view text) {
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    out.put('"');
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        const auto c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        out.put(text.substr(start, i - start));
+        start = i + 1;
+        switch (c) {
+            case '"':  out.put(std::string_view("\\\"")); break;
+            case '\\': out.put(std::string_view("\\\\")); break;
+            case '\b': out.put(std::string_view("\\b"));  break;
+            case '\f': out.put(std::string_view("\\f"));  break;
+            case '\n': out.put(std::string_view("\\n"));  break;
+            case '\r': out.put(std::string_view("\\r"));  break;
+            case '\t': out.put(std::string_view("\\t"));  break;
+            default: {
+                const char escaped[] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xF]};
+                out.put(std::string_view(escaped, sizeof(escaped)));
+            }
+        }
+    }
+    out.put(text.substr(start));
+    out.put('"');
+}
+
+// Leads every netlist image. Counts are elements, not bytes.
+struct ImageHeader {
+    std::uint32_t net_count;
+    std::uint32_t module_count;
+    std::uint32_t pin_count;
+    std::uint32_t fanout_count;
+    std::uint32_t names_size;
+    std::uint32_t param_word_count;
+    std::uint32_t kind_count;
+    std::uint32_t kind_names_size;
+    std::uint32_t id_limit;
+    std::uint32_t reserved;
+};
+
+constexpr std::size_t IMAGE_ALIGN = 8;
+
+template <typename T>
+void put(std::ostream& os, std::span<const T> column) {
+    static constexpr char zeros[IMAGE_ALIGN] = {};
+    const std::size_t bytes = column.size_bytes();
+    os.write(reinterpret_cast<const char*>(column.data()), static_cast<std::streamsize>(bytes));
+    os.write(zeros, static_cast<std::streamsize>((IMAGE_ALIGN - bytes % IMAGE_ALIGN) % IMAGE_ALIGN));
+}
+
+// Walks an image column by column, checking each fits and is aligned
+class ImageReader {
+public:
+    explicit ImageReader(std::span<const std::byte> image) : image(image) {}
+
+    template <typename T>
+    std::span<const T> take(std::size_t count) {
+        const std::size_t bytes = count * sizeof(T);
+        if (bytes > image.size() - pos)
+            throw std::runtime_error("Truncated netlist image");
+        if (reinterpret_cast<std::uintptr_t>(image.data() + pos) % alignof(T))
+            throw std::runtime_error("Misaligned netlist image");
+
+        std::span<const T> column(reinterpret_cast<const T*>(image.data() + pos), count);
+        pos += (bytes + IMAGE_ALIGN - 1) / IMAGE_ALIGN * IMAGE_ALIGN;
+        pos  = std::min(pos, image.size());
+        return column;
+    }
+
+private:
+    std::span<const std::byte> image;
+    std::size_t                pos{0};
+};
+
+// Offsets must start at 0, never decrease and end at `total`
+void check_offsets(std::span<const std::uint32_t> offsets, std::size_t total, const char* what) {
+    if (offsets.front() != 0 || offsets.back() != total || !std::ranges::is_sorted(offsets))
+        throw std::runtime_error(std::string("Corrupt netlist image: bad ") + what + " offsets");
+}
+
+void check_indices(std::span<const std::uint32_t> indices, std::size_t limit, bool allow_none, const char* what) {
+    for (std::uint32_t index : indices)
+        if (index >= limit && !(allow_none && index == CompactNetlist::NONE))
+            throw std::runtime_error(std::string("Corrupt netlist image: bad ") + what);
+}
+
+}
+
+// Storage a Builder fills and a finished netlist keeps alive
+struct CompactNetlist::Columns {
+    std::vector<std::uint32_t> net_ids;
+    std::vector<std::uint8_t>  net_types;
+    std::vector<Index>         net_drivers;
+    std::vector<std::uint32_t> name_offsets{0};
+    std::vector<char>          names;
+    std::vector<Index>         fanout_offsets;
+    std::vector<Index>         fanout_pins;
+
+    std::vector<std::uint32_t> module_ids;
+    std::vector<std::uint32_t> module_kinds;
+    std::vector<Index>         module_pins{0};
+    std::vector<std::uint32_t> param_offsets{0};
+    std::vector<std::uint64_t> param_words;
+
+    std::vector<Index>         pin_nets;
+    std::vector<Index>         pin_modules;
+};
+
+CompactNetlist::Builder::Builder() : columns(std::make_shared<Columns>()) {}
+
+CompactNetlist::Index CompactNetlist::Builder::add_net(std::uint32_t id, NetType type, std::string_view name) {
+    Columns& c = *columns;
+    c.net_ids.push_back(id);
+    c.net_types.push_back(static_cast<std::uint8_t>(type));
+    c.net_drivers.push_back(NONE);
+    c.names.insert(c.names.end(), name.begin(), name.end());
+    c.name_offsets.push_back(static_cast<std::uint32_t>(c.names.size()));
+    set_next_id(id + 1);
+    return static_cast<Index>(c.net_ids.size() - 1);
+}
+
+CompactNetlist::Index CompactNetlist::Builder::add_module(std::uint32_t id, const ModuleSpec& spec) {
+    Columns& c = *columns;
+    const Index module = static_cast<Index>(c.module_ids.size());
+
+    auto [kind, added] = kind_index.try_emplace(&spec, static_cast<std::uint32_t>(kinds.size()));
+    if (added) kinds.push_back(&spec);
+
+    c.module_ids.push_back(id);
+    c.module_kinds.push_back(kind->second);
+
+    const int pins = spec.input_bits + spec.output_bits;
+    c.pin_nets.insert(c.pin_nets.end(), pins, NONE);
+    c.pin_modules.insert(c.pin_modules.end(), pins, module);
+    c.module_pins.push_back(static_cast<Index>(c.pin_nets.size()));
+
+    c.param_words.insert(c.param_words.end(), spec.param_words, 0);
+    c.param_offsets.push_back(static_cast<std::uint32_t>(c.param_words.size()));
+
+    set_next_id(id + 1);
+    return module;
+}
+
+const ModuleSpec& CompactNetlist::Builder::module_spec(Index module) const {
+    return *kinds[columns->module_kinds[module]];
+}
+
+CompactNetlist::Index CompactNetlist::Builder::first_pin(Index module) const {
+    return columns->module_pins[module];
+}
+
+void CompactNetlist::Builder::connect(Index pin, Index net) {
+    Columns& c = *columns;
+    const Index module = c.pin_modules[pin];
+    c.pin_nets[pin] = net;
+    if (pin - c.module_pins[module] >= static_cast<Index>(module_spec(module).input_bits))
+        c.net_drivers[net] = pin;
+}
+
+void CompactNetlist::Builder::set_param(Index module, std::size_t param, std::span<const std::uint64_t> words) {
+    const ParamSpec&  p      = module_spec(module).params[param];
+    const std::size_t offset = columns->param_offsets[module] + p.offset;
+
+    if (words.size() != static_cast<std::size_t>(packed::word_count(p.width)))
+        throw std::runtime_error("Parameter width mismatch: " + p.name);
+    std::copy(words.begin(), words.end(), columns->param_words.begin() + offset);
+}
+
+void CompactNetlist::Builder::set_param(Index module, std::size_t param, std::string_view value) {
+    const ParamSpec&  p      = module_spec(module).params[param];
+    const std::size_t offset = columns->param_offsets[module] + p.offset;
+
+    packed::parse(value, p.width, std::span(columns->param_words).subspan(offset, packed::word_count(p.width)));
+}
+
+// Fanout of every net from the input pins, in pin order
+CompactNetlist CompactNetlist::Builder::finalize() {
+    Columns& c = *columns;
+    c.fanout_offsets.assign(c.net_ids.size() + 1, 0);
+
+    const Index module_count = static_cast<Index>(c.module_ids.size());
+    for (Index module = 0; module < module_count; ++module) {
+        const Index end = c.module_pins[module] + module_spec(module).input_bits;
+        for (Index pin = c.module_pins[module]; pin < end; ++pin)
+            if (c.pin_nets[pin] != NONE)
+                ++c.fanout_offsets[c.pin_nets[pin] + 1];
+    }
+
+    for (std::size_t net = 0; net < c.net_ids.size(); ++net)
+        c.fanout_offsets[net + 1] += c.fanout_offsets[net];
+
+    c.fanout_pins.resize(c.fanout_offsets.back());
+    std::vector<Index> fill(c.fanout_offsets.begin(), c.fanout_offsets.end() - 1);
+
+    for (Index module = 0; module < module_count; ++module) {
+        const Index end = c.module_pins[module] + module_spec(module).input_bits;
+        for (Index pin = c.module_pins[module]; pin < end; ++pin)
+            if (c.pin_nets[pin] != NONE)
+                c.fanout_pins[fill[c.pin_nets[pin]]++] = pin;
+    }
+
+    CompactNetlist compact;
+    compact.kinds          = std::move(kinds);
+    compact.id_limit       = id_limit;
+    compact.net_ids        = c.net_ids;
+    compact.net_types      = c.net_types;
+    compact.net_drivers    = c.net_drivers;
+    compact.name_offsets   = c.name_offsets;
+    compact.names          = c.names;
+    compact.fanout_offsets = c.fanout_offsets;
+    compact.fanout_pins    = c.fanout_pins;
+    compact.module_ids     = c.module_ids;
+    compact.module_kinds   = c.module_kinds;
+    compact.module_pins    = c.module_pins;
+    compact.param_offsets  = c.param_offsets;
+    compact.param_words    = c.param_words;
+    compact.pin_nets       = c.pin_nets;
+    compact.pin_modules    = c.pin_modules;
+    compact.storage        = std::move(columns);
+
+    columns = std::make_shared<Columns>();
+    kind_index.clear();
+    id_limit = 1;
+    return compact;
+}
+
+CompactNetlist CompactNetlist::from_json(const nlohmann::json& json_netlist, const Library& lib) {
+    Builder compact;
+    std::vector<Index> by_id;
+
+    for (const auto& net_json : json_netlist.at("nets")) {
+        std::string name = net_json.value("name", "");
+        int id = net_json.value("id", -1);
+        if (id < 0) {
+            throw std::runtime_error("Invalid net ID in JSON: " + std::to_string(id));
+        }
+        NetType type = static_cast<NetType>(net_json.value("type", -1));
+
+        if (static_cast<std::size_t>(id) >= by_id.size())
+            by_id.resize(std::max<std::size_t>(id + 1, by_id.size() * 2), NONE);
+        by_id[id] = compact.add_net(id, type, name);
+    }
+
+    auto lookup = [&](int net_id) {
+        if (static_cast<std::size_t>(net_id) >= by_id.size() || by_id[net_id] == NONE)
+            throw std::runtime_error("Net not found");
+        return by_id[net_id];
+    };
+
+    for (const auto& module_json : json_netlist.at("modules")) {
+        int id = module_json.value("id", -1);
+        if (id < 0) {
+            throw std::runtime_error("Invalid module ID in JSON: " + std::to_string(id));
+        }
+        const ModuleSpec& spec   = lib.get_module(module_json.value("name", ""));
+        const Index       module = compact.add_module(id, spec);
+
+        Index pin = compact.first_pin(module);
+        auto connect_port = [&](const PortSpec& port) {
+            const auto& net_ids = module_json.at("ports").at(port.name).at("net_ids");
+            for (int i = 0; i < port.width; ++i, ++pin) {
+                int net_id = net_ids.at(i);
+                if (net_id >= 0)
+                    compact.connect(pin, lookup(net_id));
+            }
+        };
+        for (const auto& port : spec.inputs)  connect_port(port);
+        for (const auto& port : spec.outputs) connect_port(port);
+
+        const auto& params = module_json.at("params");
+        for (std::size_t i = 0; i < spec.params.size(); ++i) {
+            auto it = params.find(spec.params[i].name);
+            if (it == params.end())
+                throw std::runtime_error("Missing parameter " + spec.params[i].name + " on module " + spec.name);
+            compact.set_param(module, i, it->get_ref<const std::string&>());
+        }
+    }
+
+    return compact.finalize();
+}
+
+void CompactNetlist::write(std::ostream& os) const {
+    std::vector<std::uint32_t> kind_name_offsets{0};
+    std::string                kind_names;
+    for (const ModuleSpec* spec : kinds) {
+        kind_names += spec->name;
+        kind_name_offsets.push_back(static_cast<std::uint32_t>(kind_names.size()));
+    }
+
+    // JSON does not carry the id counter, only the ids; record the next id
+    // loading it would give so both formats reduce the same way
+    std::uint32_t next_id = 1;
+    for (std::uint32_t id : net_ids)    next_id = std::max(next_id, id + 1);
+    for (std::uint32_t id : module_ids) next_id = std::max(next_id, id + 1);
+
+    const ImageHeader header{
+        static_cast<std::uint32_t>(net_count()),
+        static_cast<std::uint32_t>(module_count()),
+        static_cast<std::uint32_t>(pin_count()),
+        static_cast<std::uint32_t>(fanout_pins.size()),
+        static_cast<std::uint32_t>(names.size()),
+        static_cast<std::uint32_t>(param_words.size()),
+        static_cast<std::uint32_t>(kinds.size()),
+        static_cast<std::uint32_t>(kind_names.size()),
+        next_id,
+        0
+    };
+    put(os, std::span<const ImageHeader>(&header, 1));
+
+    put(os, std::span<const std::uint32_t>(kind_name_offsets));
+    put(os, std::span<const char>(kind_names));
+
+    // An empty netlist has no offset columns yet; the image always carries them
+    const std::uint32_t zero = 0;
+    auto offsets = [&](std::span<const std::uint32_t> column) {
+        return column.empty() ? std::span<const std::uint32_t>(&zero, 1) : column;
+    };
+
+    put(os, net_ids);
+    put(os, net_types);
+    put(os, net_drivers);
+    put(os, offsets(name_offsets));
+    put(os, names);
+    put(os, offsets(fanout_offsets));
+    put(os, fanout_pins);
+
+    put(os, module_ids);
+    put(os, module_kinds);
+    put(os, offsets(module_pins));
+    put(os, offsets(param_offsets));
+    put(os, param_words);
+
+    put(os, pin_nets);
+    put(os, pin_modules);
+}
+
+CompactNetlist CompactNetlist::map(std::span<const std::byte> image, const Library& lib,
+                                   std::shared_ptr<const void> storage) {
+    ImageReader reader(image);
+    const ImageHeader& h = reader.take<ImageHeader>(1).front();
+
+    CompactNetlist compact;
+    compact.id_limit = h.id_limit;
+
+    const auto kind_name_offsets = reader.take<std::uint32_t>(std::size_t{h.kind_count} + 1);
+    const auto kind_names        = reader.take<char>(h.kind_names_size);
+    check_offsets(kind_name_offsets, kind_names.size(), "module name");
+    for (std::uint32_t k = 0; k < h.kind_count; ++k)
+        compact.kinds.push_back(&lib.get_module(std::string(kind_names.data() + kind_name_offsets[k],
+                                                            kind_name_offsets[k + 1] - kind_name_offsets[k])));
+
+    compact.net_ids        = reader.take<std::uint32_t>(h.net_count);
+    compact.net_types      = reader.take<std::uint8_t> (h.net_count);
+    compact.net_drivers    = reader.take<Index>        (h.net_count);
+    compact.name_offsets   = reader.take<std::uint32_t>(std::size_t{h.net_count} + 1);
+    compact.names          = reader.take<char>         (h.names_size);
+    compact.fanout_offsets = reader.take<Index>        (std::size_t{h.net_count} + 1);
+    compact.fanout_pins    = reader.take<Index>        (h.fanout_count);
+
+    compact.module_ids     = reader.take<std::uint32_t>(h.module_count);
+    compact.module_kinds   = reader.take<std::uint32_t>(h.module_count);
+    compact.module_pins    = reader.take<Index>        (std::size_t{h.module_count} + 1);
+    compact.param_offsets  = reader.take<std::uint32_t>(std::size_t{h.module_count} + 1);
+    compact.param_words    = reader.take<std::uint64_t>(h.param_word_count);
+
+    compact.pin_nets       = reader.take<Index>        (h.pin_count);
+    compact.pin_modules    = reader.take<Index>        (h.pin_count);
+
+    // Everything below indexes with these columns, so bound them all first
+    check_offsets(compact.name_offsets,   h.names_size,       "name");
+    check_offsets(compact.fanout_offsets, h.fanout_count,     "fanout");
+    check_offsets(compact.module_pins,    h.pin_count,        "pin");
+    check_offsets(compact.param_offsets,  h.param_word_count, "parameter");
+    check_indices(compact.module_kinds,   h.kind_count,  false, "module kind");
+    check_indices(compact.net_drivers,    h.pin_count,   true,  "net driver");
+    check_indices(compact.fanout_pins,    h.pin_count,   false, "fanout pin");
+    check_indices(compact.pin_nets,       h.net_count,   true,  "pin net");
+
+    for (std::uint8_t type : compact.net_types)
+        if (type >= NET_TYPE_COUNT)
+            throw std::runtime_error("Corrupt netlist image: bad net type");
+
+    for (Index module = 0; module < h.module_count; ++module) {
+        const ModuleSpec& spec = compact.module_spec(module);
+        if (compact.module_pins[module + 1] - compact.module_pins[module] != static_cast<Index>(spec.input_bits + spec.output_bits) ||
+            compact.param_offsets[module + 1] - compact.param_offsets[module] != static_cast<std::uint32_t>(spec.param_words))
+            throw std::runtime_error("Corrupt netlist image: module " + std::to_string(compact.module_ids[module]) +
+                                     " does not match " + spec.name);
+        for (Index pin = compact.module_pins[module]; pin < compact.module_pins[module + 1]; ++pin)
+            if (compact.pin_modules[pin] != module)
+                throw std::runtime_error("Corrupt netlist image: bad pin module");
+    }
+
+    compact.storage = std::move(storage);
+    return compact;
+}
+
+std::string_view CompactNetlist::net_name(Index net) const {
+    return std::string_view(names.data() + name_offsets[net], name_offsets[net + 1] - name_offsets[net]);
+}
+
+std::span<const CompactNetlist::Index> CompactNetlist::fanout(Index net) const {
+    return fanout_pins.subspan(fanout_offsets[net], fanout_offsets[net + 1] - fanout_offsets[net]);
+}
+
+std::span<const std::uint64_t> CompactNetlist::param(Index module, std::size_t param) const {
+    const ParamSpec& p = module_spec(module).params[param];
+    return param_words.subspan(param_offsets[module] + p.offset, packed::word_count(p.width));
+}
+
+CompactNetlist::PinRef CompactNetlist::locate(Index pin) const {
+    const ModuleSpec& spec   = module_spec(pin_modules[pin]);
+    const int         offset = static_cast<int>(pin - first_pin(pin_modules[pin]));
+
+    for (const auto* ports : {&spec.inputs, &spec.outputs})
+        for (const auto& port : *ports)
+            if (offset < port.offset + port.width) return PinRef{&port, offset - port.offset};
+    throw std::out_of_range("Pin outside its module");
+}
+
+int CompactNetlist::id_width() const {
+    return static_cast<int>(std::log10(id_limit)) + 1;
+}
+
+std::string CompactNetlist::net_lable(Index net, int width) const {
+    std::string_view name = net_name(net);
+    if (!name.empty()) return std::string(name);
+    if (width == 0) return "net_" + std::to_string(net_ids[net]);
+    return padded_id(net_ids[net], width);
+}
+
+std::string CompactNetlist::module_lable(Index module, int width) const {
+    if (width == 0) return module_spec(module).name + "_" + std::to_string(module_ids[module]);
+    return padded_id(module_ids[module], width);
+}
+
+void CompactNetlist::fanin_cone(Index net, std::vector<bool>& nets, std::vector<bool>& modules) const {
+    nets.assign(net_count(), false);
+    modules.assign(module_count(), false);
+
+    std::vector<Index> work{net};
+    nets[net] = true;
+
+    for (std::size_t i = 0; i < work.size(); ++i) {
+        const Index pin = net_drivers[work[i]];
+        if (pin == NONE) continue;
+
+        const Index module = pin_modules[pin];
+        if (modules[module]) continue;
+        modules[module] = true;
+
+        const Index end = first_pin(module) + module_spec(module).input_bits;
+        for (Index input = first_pin(module); input < end; ++input) {
+            const Index source = pin_nets[input];
+            if (source != NONE && !nets[source]) {
+                nets[source] = true;
+                work.push_back(source);
+            }
+        }
+    }
+}
+
+// Labels and the fixed text of each module kind are formatted once up front,
+// so the per-module work is copying them into a large output buffer
+void CompactNetlist::emit_verilog(std::ostream& os, const std::string& top_name) const {
+    const int width = id_width();
+
+    // One 16-byte slot per net so a pin reference is a single aligned lookup;
+    // names too long for a slot are kept aside
+    struct Slot {
+        char         text[15];
+        std::uint8_t size;
+    };
+    static constexpr std::uint8_t LONG = 0xFF;
+
+    std::vector<Slot>        slots(net_count());
+    std::vector<std::string> long_labels;
+
+    for (Index net = 0; net < net_count(); ++net) {
+        const std::string_view name = net_name(net);
+        Slot& slot = slots[net];
+        if (name.empty()) {
+            slot.size = static_cast<std::uint8_t>(format_padded_id(slot.text, net_ids[net], width));
+        } else if (name.size() < sizeof(slot.text)) {
+            std::memcpy(slot.text, name.data(), name.size());
+            slot.size = static_cast<std::uint8_t>(name.size());
+        } else {
+            const auto index = static_cast<std::uint32_t>(long_labels.size());
+            long_labels.emplace_back(name);
+            std::memcpy(slot.text, &index, sizeof(index));
+            slot.size = LONG;
+        }
+    }
+
+    auto label = [&](Index net) {
+        const Slot& slot = slots[net];
+        if (slot.size != LONG) return std::string_view(slot.text, slot.size);
+        std::uint32_t index;
+        std::memcpy(&index, slot.text, sizeof(index));
+        return std::string_view(long_labels[index]);
+    };
+
+    std::vector<Index> top_inputs;
+    std::vector<Index> top_outputs;
+
+    for (Index net = 0; net < net_count(); ++net) {
+        if (net_type(net) == NetType::EXT_IN ||
+            net_type(net) == NetType::EXT_CLK)
+            top_inputs.push_back(net);
+        else if (net_type(net) == NetType::EXT_OUT)
+            top_outputs.push_back(net);
+    }
+
+    OutputBuffer out(os);
+
+    out.put("module ");
+    out.put(top_name);
+    out.put('(');
+    for (size_t i = 0; i < top_inputs.size(); ++i) {
+        out.put(label(top_inputs[i]));
+        if (i + 1 < top_inputs.size()) out.put(", ");
+    }
+    if (!top_outputs.empty()) out.put(", ");
+    for (size_t i = 0; i < top_outputs.size(); ++i) {
+        out.put(label(top_outputs[i]));
+        if (i + 1 < top_outputs.size()) out.put(", ");
+    }
+    out.put(");\n");
+
+    for (Index net : top_inputs) {
+        out.put("  input  ");
+        out.put(label(net));
+        out.put(";\n");
+    }
+    for (Index net : top_outputs) {
+        out.put("  output ");
+        out.put(label(net));
+        out.put(";\n");
+    }
+
+    for (Index net = 0; net < net_count(); ++net)
+        if (net_type(net) == NetType::LOGIC) {
+            out.put("  wire   ");
+            out.put(label(net));
+            out.put(";\n");
+        }
+
+    std::vector<VerilogKindText> kind_text;
+    kind_text.reserve(kinds.size());
+    for (const ModuleSpec* spec : kinds)
+        kind_text.emplace_back(*spec);
+
+    for (Index module = 0; module < module_count(); ++module) {
+        const ModuleSpec&      spec = module_spec(module);
+        const VerilogKindText& text = kind_text[module_kinds[module]];
+
+        // Pin labels are random accesses; start fetching them a few modules ahead
+        if (module + 8 < module_count())
+            for (Index p = module_pins[module + 8]; p < module_pins[module + 9]; ++p)
+                if (pin_nets[p] != NONE) __builtin_prefetch(&slots[pin_nets[p]]);
+
+        out.put(text.head);
+        for (std::size_t i = 0; i < spec.params.size(); ++i) {
+            out.put_binary(param(module, i), spec.params[i].width);
+            out.put(text.param_text[i]);
+        }
+
+        out.put_padded_id(module_ids[module], width);
+        out.put(" (\n");
+
+        Index       pin        = first_pin(module);
+        std::size_t port_index = 0;
+        for (const auto* ports : {&spec.inputs, &spec.outputs})
+            for (const auto& port : *ports) {
+                out.put(text.port_text[port_index]);
+                for (int j = 0; j < port.width; ++j, ++pin) {
+                    const Index net = pin_nets[pin];
+                    if (net != NONE && slots[net].size != LONG) {
+                        char* p = out.reserve(sizeof(Slot));
+                        std::memcpy(p, &slots[net], sizeof(Slot));
+                        out.commit(p + slots[net].size);
+                    } else if (net != NONE) {
+                        out.put(label(net));
+                    } else {
+                        out.put("1'b0");
+                    }
+                    if (j + 1 < port.width) out.put(", ");
+                }
+                out.put(text.port_close[port_index++]);
+            }
+        out.put("  );\n");
+    }
+    out.put("endmodule\n");
+}
+
+void CompactNetlist::emit_dotfile(std::ostream& os, const std::string& top) const {
+    os << "digraph \"" << top << "\" {\n"
+       << "rankdir=\"LR\";\n"
+       << "remincross=true;\n";
+
+    for (Index m = 0; m < module_count(); ++m) {
+        const ModuleSpec& spec  = module_spec(m);
+        const std::string label = module_lable(m);
+
+        for (const auto& p : spec.inputs) {
+            if (p.width > 1) {
+                const std::string bus = label + "_" + p.name;
+
+                os << "  " << bus << R"( [shape=record,style=rounded,label=")";
+                for (int b = p.width - 1; b >= 0; --b) {
+                    os << "<s" << b << "> " << b << ':' << b;
+                    if (b) os << " | ";
+                }
+                os << R"(",color="black",fontcolor="black"])" << ";\n";
+
+                os << "  " << bus << ":e -> "
+                   << label << ":<" << p.name << ">:w "
+                   << R"([arrowhead=odiamond,arrowtail=odiamond,dir=both,)"
+                   << "style=\"setlinewidth(" << p.width
+                   << ")\",color=\"black\",fontcolor=\"black\"];\n";
+            }
+        }
+
+        for (const auto& p : spec.outputs) {
+            if (p.width > 1) {
+                const std::string bus = label + "_" + p.name;
+
+                os << "  " << bus << R"( [shape=record,style=rounded,label=")";
+                for (int b = p.width - 1; b >= 0; --b) {
+                    os << "<s" << b << "> " << b << ':' << b;
+                    if (b) os << " | ";
+                }
+                os << R"(",color="black",fontcolor="black"])" << ";\n";
+
+                os << "  " << label << ":<" << p.name << ">:e -> "
+                   << bus << ":w "
+                   << R"([arrowhead=odiamond,arrowtail=odiamond,dir=both,)"
+                   << "style=\"setlinewidth(" << p.width
+                   << ")\",color=\"black\",fontcolor=\"black\"];\n";
+            }
+        }
+
+        os << "  " << label
+           << R"( [shape=record,label="{{)";
+        for (std::size_t i = 0; i < spec.inputs.size(); ++i) {
+            os << '<' << spec.inputs[i].name << "> " << spec.inputs[i].name;
+            if (i + 1 < spec.inputs.size()) os << " | ";
+        }
+        os << "} | " << spec.name << " | {";
+        for (std::size_t i = 0; i < spec.outputs.size(); ++i) {
+            os << '<' << spec.outputs[i].name << "> " << spec.outputs[i].name;
+            if (i + 1 < spec.outputs.size()) os << " | ";
+        }
+        os << R"(}}",color="black",fontcolor="black"])" << ";\n";
+    }
+
+    auto edge = [&](const std::string& s, const std::string& d) {
+        os << "  " << s << " -> " << d
+           << R"( [color="black",fontcolor="black"])" << ";\n";
+    };
+
+    for (Index n = 0; n < net_count(); ++n) {
+        const std::string nid = net_lable(n);
+
+        auto net_node = [&](const char* shape) {
+            os << "  " << nid << " [shape=" << shape
+               << ",label=\"" << nid
+               << R"(",color="black",fontcolor="black"])" << ";\n";
+        };
+
+        switch (net_type(n)) {
+        case NetType::EXT_IN:
+        case NetType::EXT_CLK: net_node("octagon"); break;
+        case NetType::EXT_OUT: net_node("octagon"); break;
+        default:               net_node("diamond"); break;
+        }
+
+        if (net_drivers[n] != NONE) {
+            const PinRef dp     = locate(net_drivers[n]);
+            const std::string m = module_lable(pin_modules[net_drivers[n]]);
+            std::string src = (dp.port->width == 1)
+                ? m + ":<" + dp.port->name + '>'
+                : m + '_' + dp.port->name
+                    + ":<s" + std::to_string(dp.bit) + '>';
+
+            edge(src, nid + ":w");
+        }
+
+        for (Index pin : fanout(n)) {
+            const PinRef sp     = locate(pin);
+            const std::string m = module_lable(pin_modules[pin]);
+            std::string dst = (sp.port->width == 1)
+                ? m + ":<" + sp.port->name + '>'
+                : m + '_' + sp.port->name
+                    + ":<s" + std::to_string(sp.bit) + ">:w";
+
+            edge(nid + ":e", dst);
+        }
+    }
+
+    os << "}\n";
+}
+
+nlohmann::json CompactNetlist::json() const {
+
+    nlohmann::json json_netlist;
+    json_netlist["version"] = "0.1";
+
+    json_netlist["nets"] = nlohmann::json::array();
+
+    for (Index net = 0; net < net_count(); ++net) {
+        nlohmann::json net_json;
+        net_json["id"] = net_ids[net];
+        net_json["name"] = net_name(net);
+        net_json["type"] = static_cast<int>(net_types[net]);
+        json_netlist["nets"].push_back(net_json);
+    }
+
+    json_netlist["modules"] = nlohmann::json::array();
+    for (Index module = 0; module < module_count(); ++module) {
+        const ModuleSpec& spec = module_spec(module);
+
+        nlohmann::json module_json;
+        module_json["id"] = module_ids[module];
+        module_json["name"] = spec.name;
+
+        Index pin = first_pin(module);
+        auto port_to_json = [&](const PortSpec& port) {
+            nlohmann::json port_json;
+            port_json["width"] = port.width;
+            port_json["net_type"] = static_cast<int>(port.net_type);
+            port_json["net_ids"] = nlohmann::json::array();
+            for (int i = 0; i < port.width; ++i, ++pin) {
+                if (pin_nets[pin] != NONE)
+                    port_json["net_ids"].push_back(net_ids[pin_nets[pin]]);
+                else
+                    port_json["net_ids"].push_back(-1);
+            }
+            return port_json;
+        };
+
+        for (const auto& port : spec.inputs)
+            module_json["ports"][port.name] = port_to_json(port);
+
+        for (const auto& port : spec.outputs)
+            module_json["ports"][port.name] = port_to_json(port);
+
+        module_json["params"] = nlohmann::json::object();
+        for (std::size_t i = 0; i < spec.params.size(); ++i)
+            module_json["params"][spec.params[i].name] = packed::to_json(param(module, i), spec.params[i].width);
+
+        json_netlist["modules"].push_back(module_json);
+    }
+
+    return json_netlist;
+}
+
+// Streams what json() would dump with setw(4), `depth` levels in: keys in
+// std::map order, so modules before nets and ports and params by name
+void CompactNetlist::write_json(std::ostream& os, int depth) const {
+    OutputBuffer out(os);
+
+    const std::string pad = "\n" + std::string(4 * (depth + 6), ' ');
+    auto newline = [&](int level) { out.put(std::string_view(pad).substr(0, 1 + 4 * (depth + level))); };
+
+    struct PortEntry {
+        const PortSpec* port;
+        Index           offset;  // of its first pin within the module
+    };
+    struct KindOrder {
+        std::vector<PortEntry>   ports;
+        std::vector<std::size_t> params;
+    };
+    std::vector<KindOrder> orders(kinds.size());
+    for (std::size_t kind = 0; kind < kinds.size(); ++kind) {
+        const ModuleSpec& spec  = *kinds[kind];
+        KindOrder&        order = orders[kind];
+
+        for (const auto& port : spec.inputs)  order.ports.push_back({&port, static_cast<Index>(port.offset)});
+        for (const auto& port : spec.outputs) order.ports.push_back({&port, static_cast<Index>(port.offset)});
+        for (std::size_t i = 0; i < spec.params.size(); ++i)
+            order.params.push_back(i);
+
+        // A repeated name keeps its last entry, as a std::map assignment would
+        auto sort_by = [](auto& entries, auto name) {
+            std::ranges::stable_sort(entries, {}, name);
+            std::ranges::reverse(entries);
+            entries.erase(std::unique(entries.begin(), entries.end(),
+                                      [&](const auto& a, const auto& b) { return name(a) == name(b); }),
+                          entries.end());
+            std::ranges::reverse(entries);
+        };
+        sort_by(order.ports,  [](const PortEntry& e) -> const std::string& { return e.port->name; });
+        sort_by(order.params, [&](std::size_t i) -> const std::string& { return spec.params[i].name; });
+    }
+
+    out.put('{');
+    newline(1);
+    out.put(std::string_view("\"modules\": "));
+    if (module_count() == 0)
+        out.put(std::string_view("[]"));
+    else {
+        out.put('[');
+        for (Index module = 0; module < module_count(); ++module) {
+            const ModuleSpec& spec  = module_spec(module);
+            const KindOrder&  order = orders[module_kinds[module]];
+
+            if (module) out.put(',');
+            newline(2);
+            out.put('{');
+            newline(3);
+            out.put(std::string_view("\"id\": "));
+            out.put(std::uint64_t{module_ids[module]});
+            out.put(',');
+            newline(3);
+            out.put(std::string_view("\"name\": "));
+            put_json_string(out, spec.name);
+            out.put(',');
+            newline(3);
+
+            out.put(std::string_view("\"params\": "));
+            if (order.params.empty())
+                out.put(std::string_view("{}"));
+            else {
+                out.put('{');
+                for (std::size_t i = 0; i < order.params.size(); ++i) {
+                    const ParamSpec& p = spec.params[order.params[i]];
+                    if (i) out.put(',');
+                    newline(4);
+                    put_json_string(out, p.name);
+                    out.put(std::string_view(": "));
+                    put_json_string(out, packed::to_json(param(module, order.params[i]), p.width));
+                }
+                newline(3);
+                out.put('}');
+            }
+
+            // Only there when the module has ports, as in the DOM
+            if (!order.ports.empty()) {
+                out.put(',');
+                newline(3);
+                out.put(std::string_view("\"ports\": {"));
+                for (std::size_t i = 0; i < order.ports.size(); ++i) {
+                    const PortSpec& port = *order.ports[i].port;
+                    const Index     pin  = first_pin(module) + order.ports[i].offset;
+
+                    if (i) out.put(',');
+                    newline(4);
+                    put_json_string(out, port.name);
+                    out.put(std::string_view(": {"));
+                    newline(5);
+                    out.put(std::string_view("\"net_ids\": "));
+                    if (port.width == 0)
+                        out.put(std::string_view("[]"));
+                    else {
+                        out.put('[');
+                        for (int bit = 0; bit < port.width; ++bit) {
+                            if (bit) out.put(',');
+                            newline(6);
+                            if (pin_nets[pin + bit] != NONE)
+                                out.put(std::uint64_t{net_ids[pin_nets[pin + bit]]});
+                            else
+                                out.put(std::string_view("-1"));
+                        }
+                        newline(5);
+                        out.put(']');
+                    }
+                    out.put(',');
+                    newline(5);
+                    out.put(std::string_view("\"net_type\": "));
+                    out.put(static_cast<std::uint64_t>(port.net_type));
+                    out.put(',');
+                    newline(5);
+                    out.put(std::string_view("\"width\": "));
+                    out.put(static_cast<std::uint64_t>(port.width));
+                    newline(4);
+                    out.put('}');
+                }
+                newline(3);
+                out.put('}');
+            }
+            newline(2);
+            out.put('}');
+        }
+        newline(1);
+        out.put(']');
+    }
+
+    out.put(',');
+    newline(1);
+    out.put(std::string_view("\"nets\": "));
+    if (net_count() == 0)
+        out.put(std::string_view("[]"));
+    else {
+        out.put('[');
+        for (Index net = 0; net < net_count(); ++net) {
+            if (net) out.put(',');
+            newline(2);
+            out.put('{');
+            newline(3);
+            out.put(std::string_view("\"id\": "));
+            out.put(std::uint64_t{net_ids[net]});
+            out.put(',');
+            newline(3);
+            out.put(std::string_view("\"name\": "));
+            put_json_string(out, net_name(net));
+            out.put(',');
+            newline(3);
+            out.put(std::string_view("\"type\": "));
+            out.put(std::uint64_t{net_types[net]});
+            newline(2);
+            out.put('}');
+        }
+        newline(1);
+        out.put(']');
+    }
+
+    out.put(',');
+    newline(1);
+    out.put(std::string_view("\"version\": \"0.1\""));
+    newline(0);
+    out.put('}');
+}
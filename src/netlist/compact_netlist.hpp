@@ -0,0 +1,129 @@
+#pragma once
+
+#include "library.hpp"
+#include "module.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Flat struct-of-arrays form of a netlist with 32-bit indices. A module's pins
+// are contiguous, inputs then outputs in spec order and bit 0 first, so the
+// port and bit of a pin follow from the spec. Fanout lists are CSR arrays
+// built by finalize(). Netlist converts to and from this form for emission,
+// JSON I/O and whole-graph traversals.
+//
+// A CompactNetlist is immutable once built. Its columns are views into shared
+// storage, either the vectors a Builder filled or a mapped snapshot image,
+// so copies are cheap.
+class CompactNetlist {
+public:
+    using Index = std::uint32_t;
+    static constexpr Index NONE = UINT32_MAX;
+
+    struct PinRef {
+        const PortSpec* port;
+        int             bit;
+    };
+
+    class Builder;
+
+    static CompactNetlist from_json(const nlohmann::json& json_netlist, const Library& lib);
+
+    // Binary image stored in .fzn snapshots: a header, the module names used,
+    // then every column 8-byte aligned. map() views one in place after range
+    // checks; `storage` must keep the bytes alive.
+    void                  write(std::ostream& os) const;
+    static CompactNetlist map  (std::span<const std::byte> image, const Library& lib,
+                                std::shared_ptr<const void> storage);
+
+    std::size_t   net_count   () const { return net_ids.size(); }
+    std::size_t   module_count() const { return module_ids.size(); }
+    std::size_t   pin_count   () const { return pin_nets.size(); }
+    std::uint32_t next_id     () const { return id_limit; }
+
+    std::uint32_t          net_id  (Index net) const { return net_ids[net]; }
+    NetType                net_type(Index net) const { return static_cast<NetType>(net_types[net]); }
+    std::string_view       net_name(Index net) const;
+    Index                  driver  (Index net) const { return net_drivers[net]; }
+    std::span<const Index> fanout  (Index net) const;
+
+    std::uint32_t     module_id  (Index module) const { return module_ids[module]; }
+    const ModuleSpec& module_spec(Index module) const { return *kinds[module_kinds[module]]; }
+    Index             first_pin  (Index module) const { return module_pins[module]; }
+    std::span<const std::uint64_t> param(Index module, std::size_t param) const;
+
+    Index  pin_module(Index pin) const { return pin_modules[pin]; }
+    Index  pin_net   (Index pin) const { return pin_nets[pin]; }
+    PinRef locate    (Index pin) const;
+
+    std::string net_lable   (Index net,    int width = 0) const;
+    std::string module_lable(Index module, int width = 0) const;
+
+    // Nets and modules `net` depends on, marked by index
+    void fanin_cone(Index net, std::vector<bool>& nets, std::vector<bool>& modules) const;
+
+    void           emit_verilog(std::ostream& os, const std::string& top_name = "top") const;
+    void           emit_dotfile(std::ostream& os, const std::string& top_name = "top") const;
+    nlohmann::json json() const;
+    // The text json() dumps to with setw(4), streamed without building the
+    // DOM; `depth` is the indent level the value starts at
+    void           write_json(std::ostream& os, int depth = 0) const;
+
+private:
+    struct Columns;
+
+    int  id_width() const;
+
+    std::shared_ptr<const void>    storage;             // owns the bytes the columns view
+    std::vector<const ModuleSpec*> kinds;               // specs in use, indexed by module_kinds
+    std::uint32_t                  id_limit{1};
+
+    std::span<const std::uint32_t> net_ids;
+    std::span<const std::uint8_t>  net_types;
+    std::span<const Index>         net_drivers;
+    std::span<const std::uint32_t> name_offsets;        // net n is named names[name_offsets[n], name_offsets[n + 1])
+    std::span<const char>          names;
+    std::span<const Index>         fanout_offsets;      // net n feeds fanout_pins[fanout_offsets[n], fanout_offsets[n + 1])
+    std::span<const Index>         fanout_pins;
+
+    std::span<const std::uint32_t> module_ids;
+    std::span<const std::uint32_t> module_kinds;
+    std::span<const Index>         module_pins;         // module m owns pins [module_pins[m], module_pins[m + 1])
+    std::span<const std::uint32_t> param_offsets;       // packed parameter words of module m, laid out by its spec
+    std::span<const std::uint64_t> param_words;
+
+    std::span<const Index>         pin_nets;
+    std::span<const Index>         pin_modules;
+};
+
+// Nets and modules first, then connect() their pins, then finalize()
+class CompactNetlist::Builder {
+public:
+    Builder();
+
+    Index add_net    (std::uint32_t id, NetType type, std::string_view name = {});
+    Index add_module (std::uint32_t id, const ModuleSpec& spec);
+    void  connect    (Index pin, Index net);
+    void  set_param  (Index module, std::size_t param, std::span<const std::uint64_t> words);
+    void  set_param  (Index module, std::size_t param, std::string_view value);
+    void  set_next_id(std::uint32_t id) { id_limit = std::max(id_limit, id); }
+    Index first_pin  (Index module) const;
+
+    CompactNetlist finalize();
+
+private:
+    const ModuleSpec& module_spec(Index module) const;
+
+    std::shared_ptr<Columns>                              columns;
+    std::vector<const ModuleSpec*>                        kinds;
+    std::unordered_map<const ModuleSpec*, std::uint32_t> kind_index;
+    std::uint32_t                                         id_limit{1};
+};
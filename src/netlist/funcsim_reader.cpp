@@ -0,0 +1,585 @@
+#include "funcsim_reader.hpp"
+#include "packed_param.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+struct Token {
+    enum Kind { END, IDENT, NUMBER, STRING, SYMBOL };
+
+    Kind             kind{END};
+    std::string_view text;
+    int              line{0};
+
+    bool is(char c) const              { return kind == SYMBOL && text[0] == c; }
+    bool is(std::string_view id) const { return kind == IDENT && text == id; }
+};
+
+// Verilog tokens with comments, (* attributes *) and `directive lines
+// dropped. Escaped identifiers come back without the backslash.
+class Lexer {
+public:
+    explicit Lexer(std::string_view src) : src(src) {}
+
+    Token next() {
+        skip_blanks();
+        Token token{Token::END, {}, line};
+        if (pos >= src.size())
+            return token;
+
+        const std::size_t start = pos;
+        const char        c     = src[pos];
+        if (c == '\\') {
+            ++pos;
+            while (pos < src.size() && !is_space(src[pos])) ++pos;
+            token.kind = Token::IDENT;
+            token.text = src.substr(start + 1, pos - start - 1);
+        } else if (is_ident_start(c)) {
+            while (pos < src.size() && is_ident(src[pos])) ++pos;
+            token.kind = Token::IDENT;
+            token.text = src.substr(start, pos - start);
+        } else if (is_digit(c) || c == '\'') {
+            while (pos < src.size() && is_digit(src[pos])) ++pos;
+            if (pos < src.size() && src[pos] == '\'') {
+                ++pos;
+                if (pos < src.size() && (src[pos] == 's' || src[pos] == 'S')) ++pos;
+                if (pos < src.size()) ++pos;  // base
+                while (pos < src.size() && (is_ident(src[pos]) || src[pos] == '?')) ++pos;
+            }
+            token.kind = Token::NUMBER;
+            token.text = src.substr(start, pos - start);
+        } else if (c == '"') {
+            ++pos;
+            while (pos < src.size() && src[pos] != '"') pos += src[pos] == '\\' ? 2 : 1;
+            pos = std::min(pos + 1, src.size());
+            token.kind = Token::STRING;
+            token.text = src.substr(start, pos - start);
+        } else {
+            ++pos;
+            token.kind = Token::SYMBOL;
+            token.text = src.substr(start, 1);
+        }
+        return token;
+    }
+
+private:
+    static bool is_space      (char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+    static bool is_digit      (char c) { return c >= '0' && c <= '9'; }
+    static bool is_ident_start(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+    static bool is_ident      (char c) { return is_ident_start(c) || is_digit(c) || c == '$'; }
+
+    void skip_to(std::string_view end) {
+        const std::size_t found = src.find(end, pos);
+        const std::size_t stop  = found == std::string_view::npos ? src.size() : found + end.size();
+        line += static_cast<int>(std::count(src.begin() + pos, src.begin() + stop, '\n'));
+        pos   = stop;
+    }
+
+    void skip_blanks() {
+        while (pos < src.size()) {
+            const char c = src[pos];
+            if (c == '\n')                                          { ++line; ++pos; }
+            else if (is_space(c))                                   ++pos;
+            else if (src.substr(pos, 2) == "//" || c == '`')        skip_to("\n");
+            else if (src.substr(pos, 2) == "/*")                    skip_to("*/");
+            else if (src.substr(pos, 2) == "(*" && src.substr(pos, 3) != "(*)") skip_to("*)");
+            else break;
+        }
+    }
+
+    std::string_view src;
+    std::size_t      pos{0};
+    int              line{1};
+};
+
+struct Signal {
+    std::string   name;
+    int           msb{0};
+    int           lsb{0};
+    bool          vector{false};
+    PortDir       dir{PortDir::INPUT};
+    bool          port{false};
+    std::uint32_t first_bit{0};
+
+    int width() const { return std::abs(msb - lsb) + 1; }
+};
+
+struct Instance {
+    const ModuleSpec*          spec;
+    std::vector<std::uint32_t> pins;         // bit per pin in spec order, NONE if open
+    std::vector<std::uint64_t> param_words;
+    std::string                extra_params;
+};
+
+constexpr std::uint32_t NONE = CompactNetlist::NONE;
+
+class Parser {
+public:
+    Parser(std::string_view src, const Library& lib) : lexer(src), lib(lib) { advance(); }
+
+    // Skips modules until `top` (or the first one) and parses it
+    FuncsimNetlist parse(const std::string& top) {
+        while (tok.kind != Token::END) {
+            if (!tok.is("module")) {
+                advance();
+                continue;
+            }
+            advance();
+            const std::string name(expect_ident());
+            if (!top.empty() && name != top) {
+                while (tok.kind != Token::END && !tok.is("endmodule")) advance();
+                continue;
+            }
+            parse_header();
+            parse_body();
+            return build(name);
+        }
+        throw std::runtime_error(top.empty() ? "No module found" : "Module not found: " + top);
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error("Line " + std::to_string(tok.line) + ": " + what);
+    }
+    [[noreturn]] void unsupported() const {
+        fail("unsupported construct '" + std::string(tok.text) + "'");
+    }
+
+    void advance() { tok = lexer.next(); }
+
+    bool accept(char c) {
+        if (!tok.is(c)) return false;
+        advance();
+        return true;
+    }
+    void expect(char c) {
+        if (!accept(c)) fail(std::string("expected '") + c + "', got '" + std::string(tok.text) + "'");
+    }
+    std::string_view expect_ident() {
+        if (tok.kind != Token::IDENT) fail("expected an identifier, got '" + std::string(tok.text) + "'");
+        const std::string_view text = tok.text;
+        advance();
+        return text;
+    }
+    int expect_int() {
+        int value = 0;
+        auto [end, ec] = std::from_chars(tok.text.data(), tok.text.data() + tok.text.size(), value);
+        if (tok.kind != Token::NUMBER || ec != std::errc{} || end != tok.text.data() + tok.text.size())
+            fail("expected an integer, got '" + std::string(tok.text) + "'");
+        advance();
+        return value;
+    }
+
+    // Balanced (...) or [...] group, contents ignored
+    void skip_group() {
+        int depth = 0;
+        do {
+            if (tok.kind == Token::END) fail("unexpected end of file");
+            if (tok.is('(') || tok.is('[') || tok.is('{')) ++depth;
+            if (tok.is(')') || tok.is(']') || tok.is('}')) --depth;
+            advance();
+        } while (depth > 0);
+    }
+
+    // Non-ANSI header: the port list only names ports, their directions
+    // come from declarations in the body
+    void parse_header() {
+        if (accept('#'))
+            skip_group();
+        if (tok.is('(')) {
+            advance();
+            while (!tok.is(')')) {
+                if (tok.is("input") || tok.is("output") || tok.is("inout"))
+                    fail("ANSI-style port declarations are not supported");
+                if (tok.kind == Token::END) fail("unexpected end of file");
+                advance();
+            }
+            advance();
+        }
+        expect(';');
+    }
+
+    void parse_body() {
+        static const std::set<std::string_view> KEYWORDS = {
+            "reg", "always", "initial", "parameter", "localparam", "function", "task", "generate",
+            "integer", "specify", "defparam", "supply0", "supply1", "tri0", "tri1", "inout", "genvar"};
+
+        while (!tok.is("endmodule")) {
+            if (tok.kind == Token::END)
+                fail("missing endmodule");
+            if (tok.is("input"))
+                parse_declaration(true, PortDir::INPUT);
+            else if (tok.is("output"))
+                parse_declaration(true, PortDir::OUTPUT);
+            else if (tok.is("wire") || tok.is("tri"))
+                parse_declaration(false, PortDir::INPUT);
+            else if (tok.is("assign"))
+                parse_assign();
+            else if (tok.kind == Token::IDENT && !KEYWORDS.contains(tok.text))
+                parse_instance();
+            else
+                unsupported();
+        }
+        advance();
+    }
+
+    void parse_declaration(bool port, PortDir dir) {
+        advance();
+        while (tok.is("wire") || tok.is("signed")) advance();
+
+        bool vector = false;
+        int  msb = 0, lsb = 0;
+        if (accept('[')) {
+            vector = true;
+            msb = expect_int();
+            expect(':');
+            lsb = expect_int();
+            expect(']');
+        }
+
+        do {
+            const std::string name(expect_ident());
+            auto it = signal_index.find(name);
+            if (it == signal_index.end())
+                it = signal_index.emplace(name, add_signal(name, vector, msb, lsb)).first;
+
+            Signal& signal = signals[it->second];
+            if (signal.vector != vector || signal.msb != msb || signal.lsb != lsb)
+                fail("conflicting declarations of " + name);
+            if (port) {
+                signal.port = true;
+                signal.dir  = dir;
+            }
+        } while (accept(','));
+        expect(';');
+    }
+
+    void parse_assign() {
+        advance();
+        if (tok.is('(')) unsupported();  // drive strength
+        do {
+            const auto lhs = parse_expr();
+            expect('=');
+            const auto rhs = parse_expr();
+            if (lhs.size() != rhs.size())
+                fail("assign width mismatch");
+            for (std::size_t i = 0; i < lhs.size(); ++i)
+                unite(lhs[i], rhs[i]);
+        } while (accept(','));
+        expect(';');
+    }
+
+    void parse_instance() {
+        const ModuleSpec& spec = lib.get_module(std::string(expect_ident()));
+
+        Instance instance{&spec, std::vector<std::uint32_t>(spec.input_bits + spec.output_bits, NONE),
+                          std::vector<std::uint64_t>(spec.param_words, 0), {}};
+
+        std::map<std::string, std::string, std::less<>> extra;
+        std::vector<bool>                               param_set(spec.params.size(), false);
+        if (accept('#')) {
+            expect('(');
+            while (!tok.is(')')) {
+                expect('.');
+                const std::string_view name = expect_ident();
+                expect('(');
+                std::string value;
+                for (int depth = 0; depth > 0 || !tok.is(')'); advance()) {
+                    if (tok.kind == Token::END) fail("unexpected end of file");
+                    if (tok.is('(')) ++depth;
+                    if (tok.is(')')) --depth;
+                    value += tok.text;
+                }
+                advance();
+
+                auto param = std::ranges::find(spec.params, name, &ParamSpec::name);
+                if (param == spec.params.end()) {
+                    extra[std::string(name)] = value;
+                } else {
+                    const auto i = static_cast<std::size_t>(param - spec.params.begin());
+                    packed::parse(value, param->width,
+                                  std::span(instance.param_words).subspan(param->offset, packed::word_count(param->width)));
+                    param_set[i] = true;
+                }
+                if (!accept(',')) break;
+            }
+            expect(')');
+        }
+        // A parameter left at its default is not the same as an explicit
+        // zero, so keep the difference visible
+        for (std::size_t i = 0; i < spec.params.size(); ++i)
+            if (!param_set[i])
+                extra[spec.params[i].name] = "default";
+        for (const auto& [name, value] : extra)
+            instance.extra_params += name + "=" + value + ";";
+
+        expect_ident();  // instance name
+        if (tok.is('[')) unsupported();
+        expect('(');
+        while (!tok.is(')')) {
+            if (!accept('.'))
+                fail("only named port connections are supported");
+            const std::string_view port_name = expect_ident();
+            expect('(');
+            std::vector<std::uint32_t> bits;
+            if (!tok.is(')'))
+                bits = parse_expr();
+            expect(')');
+
+            const PortSpec* port = find_port(spec, port_name);
+            if (!port)
+                fail("no port " + std::string(port_name) + " on " + spec.name);
+            if (!bits.empty() && bits.size() != static_cast<std::size_t>(port->width))
+                fail("width mismatch on " + spec.name + "." + port->name);
+            for (std::size_t b = 0; b < bits.size(); ++b)
+                instance.pins[port->offset + b] = bits[bits.size() - 1 - b];
+
+            if (!accept(',')) break;
+        }
+        expect(')');
+        expect(';');
+        instances.push_back(std::move(instance));
+    }
+
+    static const PortSpec* find_port(const ModuleSpec& spec, std::string_view name) {
+        for (const auto* ports : {&spec.inputs, &spec.outputs})
+            for (const auto& port : *ports)
+                if (port.name == name) return &port;
+        return nullptr;
+    }
+
+    // Bits MSB first
+    std::vector<std::uint32_t> parse_expr() {
+        std::vector<std::uint32_t> bits;
+        if (accept('{')) {
+            if (tok.kind == Token::NUMBER && tok.text.find('\'') == std::string_view::npos) {
+                const int count = expect_int();
+                const auto inner = parse_expr();
+                for (int i = 0; i < count; ++i)
+                    bits.insert(bits.end(), inner.begin(), inner.end());
+            } else {
+                do {
+                    const auto part = parse_expr();
+                    bits.insert(bits.end(), part.begin(), part.end());
+                } while (accept(','));
+            }
+            expect('}');
+            return bits;
+        }
+
+        if (tok.kind == Token::NUMBER) {
+            for (bool bit : literal_bits(tok.text))
+                bits.push_back(constant(bit));
+            advance();
+            return bits;
+        }
+
+        const std::string name(expect_ident());
+        auto it = signal_index.find(name);
+        if (it == signal_index.end())  // implicit net
+            it = signal_index.emplace(name, add_signal(name, false, 0, 0)).first;
+        const Signal& signal = signals[it->second];
+
+        if (accept('[')) {
+            const int from = expect_int();
+            const int to   = accept(':') ? expect_int() : from;
+            expect(']');
+            if (!signal.vector) fail(name + " is not a vector");
+            for (int i = from; ; i += from <= to ? 1 : -1) {
+                bits.push_back(bit_of(signal, i));
+                if (i == to) break;
+            }
+            return bits;
+        }
+        for (int k = signal.width() - 1; k >= 0; --k)
+            bits.push_back(signal.first_bit + k);
+        return bits;
+    }
+
+    // Sized literals only, MSB first
+    std::vector<bool> literal_bits(std::string_view text) const {
+        const auto tick = text.find('\'');
+        int width = 0;
+        auto [end, ec] = std::from_chars(text.data(), text.data() + tick, width);
+        if (tick == std::string_view::npos || ec != std::errc{} || end != text.data() + tick || width <= 0)
+            fail("unsized constant " + std::string(text));
+
+        std::string_view digits = text.substr(tick + 1);
+        if (!digits.empty() && (digits[0] == 's' || digits[0] == 'S'))
+            digits.remove_prefix(1);
+        if (digits.empty())
+            fail("bad constant " + std::string(text));
+
+        const char base = static_cast<char>(std::tolower(static_cast<unsigned char>(digits[0])));
+        std::string value;
+        for (char c : digits.substr(1))
+            if (c != '_') value += c;
+
+        std::vector<std::uint64_t> words(packed::word_count(width));
+        try {
+            if (base == 'd') {
+                std::uint64_t number = 0;
+                auto [dend, dec] = std::from_chars(value.data(), value.data() + value.size(), number);
+                if (dec != std::errc{} || dend != value.data() + value.size() || (width < 64 && number >> width))
+                    throw std::runtime_error("bad decimal");
+                words[0] = number;
+            } else if (base == 'h' || base == 'b') {
+                // Leading zeros beyond the width are legal Verilog
+                const int  bits_per_digit = base == 'h' ? 4 : 1;
+                const auto keep           = static_cast<std::size_t>((width + bits_per_digit - 1) / bits_per_digit);
+                if (value.size() > keep && value.find_first_not_of('0') >= value.size() - keep)
+                    value.erase(0, value.size() - keep);
+                packed::parse(std::to_string(width) + "'" + base + value, width, words);
+            } else {
+                throw std::runtime_error("bad base");
+            }
+        } catch (const std::exception&) {
+            fail("unsupported constant " + std::string(text));
+        }
+
+        std::vector<bool> bits(width);
+        for (int b = 0; b < width; ++b)
+            bits[width - 1 - b] = (words[b / 64] >> (b % 64)) & 1;
+        return bits;
+    }
+
+    std::uint32_t constant(bool one) {
+        const std::string name = one ? "<const1>" : "<const0>";
+        auto it = signal_index.find(name);
+        if (it == signal_index.end())
+            it = signal_index.emplace(name, add_signal(name, false, 0, 0)).first;
+        return signals[it->second].first_bit;
+    }
+
+    std::uint32_t bit_of(const Signal& signal, int i) const {
+        const int k = signal.msb >= signal.lsb ? i - signal.lsb : signal.lsb - i;
+        if (k < 0 || k >= signal.width())
+            fail("index " + std::to_string(i) + " out of range for " + signal.name);
+        return signal.first_bit + static_cast<std::uint32_t>(k);
+    }
+
+    std::string bit_name(const Signal& signal, std::uint32_t bit) const {
+        if (!signal.vector) return signal.name;
+        const int k = static_cast<int>(bit - signal.first_bit);
+        return signal.name + "[" + std::to_string(signal.msb >= signal.lsb ? signal.lsb + k : signal.lsb - k) + "]";
+    }
+
+    std::size_t add_signal(const std::string& name, bool vector, int msb, int lsb) {
+        Signal signal{name, msb, lsb, vector, PortDir::INPUT, false, static_cast<std::uint32_t>(parent.size())};
+        for (int k = 0; k < signal.width(); ++k) {
+            parent.push_back(static_cast<std::uint32_t>(parent.size()));
+            bit_signal.push_back(static_cast<std::uint32_t>(signals.size()));
+        }
+        signals.push_back(std::move(signal));
+        return signals.size() - 1;
+    }
+
+    std::uint32_t find(std::uint32_t bit) {
+        while (parent[bit] != bit)
+            bit = parent[bit] = parent[parent[bit]];
+        return bit;
+    }
+    void unite(std::uint32_t a, std::uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+
+    // One net per assign-joined class of bits, named after a port bit in it
+    // if there is one
+    FuncsimNetlist build(const std::string& name) {
+        FuncsimNetlist result;
+        result.top = name;
+
+        const auto bit_count = static_cast<std::uint32_t>(parent.size());
+        std::vector<std::uint32_t> name_bit(bit_count, NONE);
+        std::vector<NetType>       type(bit_count, NetType::LOGIC);
+        for (std::uint32_t bit = 0; bit < bit_count; ++bit) {
+            const std::uint32_t root   = find(bit);
+            const Signal&       signal = signals[bit_signal[bit]];
+            if (name_bit[root] == NONE || (signal.port && !signals[bit_signal[name_bit[root]]].port))
+                name_bit[root] = bit;
+            if (signal.port && type[root] != NetType::EXT_IN)
+                type[root] = signal.dir == PortDir::INPUT ? NetType::EXT_IN : NetType::EXT_OUT;
+        }
+
+        CompactNetlist::Builder builder;
+        std::vector<CompactNetlist::Index> net_of(bit_count, NONE);
+        std::uint32_t id = 1;
+        for (std::uint32_t bit = 0; bit < bit_count; ++bit)
+            if (find(bit) == bit)
+                net_of[bit] = builder.add_net(id++, type[bit], bit_name(signals[bit_signal[name_bit[bit]]], name_bit[bit]));
+
+        std::vector<bool> driven(id - 1, false);
+        for (const Instance& instance : instances) {
+            const ModuleSpec&           spec   = *instance.spec;
+            const CompactNetlist::Index module = builder.add_module(id++, spec);
+
+            for (std::size_t i = 0; i < spec.params.size(); ++i)
+                builder.set_param(module, i, std::span(instance.param_words)
+                                                 .subspan(spec.params[i].offset, packed::word_count(spec.params[i].width)));
+
+            for (std::size_t pin = 0; pin < instance.pins.size(); ++pin) {
+                if (instance.pins[pin] == NONE) continue;
+                const std::uint32_t         root = find(instance.pins[pin]);
+                const CompactNetlist::Index net  = net_of[root];
+                if (static_cast<int>(pin) >= spec.input_bits) {
+                    if (driven[net])
+                        throw std::runtime_error("Net " + bit_name(signals[bit_signal[name_bit[root]]], name_bit[root]) +
+                                                 " has several drivers");
+                    driven[net] = true;
+                }
+                builder.connect(builder.first_pin(module) + static_cast<CompactNetlist::Index>(pin), net);
+            }
+            result.extra_params.push_back(instance.extra_params);
+        }
+        result.netlist = builder.finalize();
+
+        for (const Signal& signal : signals) {
+            if (!signal.port) continue;
+            auto& ports = signal.dir == PortDir::INPUT ? result.inputs : result.outputs;
+            for (int k = 0; k < signal.width(); ++k) {
+                const std::uint32_t bit = signal.first_bit + static_cast<std::uint32_t>(k);
+                ports.push_back({bit_name(signal, bit), net_of[find(bit)]});
+            }
+        }
+        return result;
+    }
+
+    Lexer          lexer;
+    Token          tok;
+    const Library& lib;
+
+    std::unordered_map<std::string, std::size_t> signal_index;
+    std::vector<Signal>                          signals;
+    std::vector<std::uint32_t>                   parent;      // union-find over signal bits, joined by assign
+    std::vector<std::uint32_t>                   bit_signal;  // signal each bit belongs to
+    std::vector<Instance>                        instances;
+};
+
+}
+
+FuncsimNetlist FuncsimNetlist::read(const std::string& path, const Library& lib, const std::string& top) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Could not open Verilog netlist: " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+
+    try {
+        return Parser(text, lib).parse(top);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
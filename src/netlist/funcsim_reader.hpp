@@ -0,0 +1,31 @@
+#pragma once
+
+#include "compact_netlist.hpp"
+#include "library.hpp"
+
+#include <string>
+#include <vector>
+
+// A flat structural netlist as Vivado writes it with `write_verilog -mode
+// funcsim`, read into a CompactNetlist over the cell library. Accepted in the
+// top module: port and wire declarations, assigns between nets and constants,
+// and instances of library cells with named connections. Anything else is an
+// error. Other modules in the file (glbl) are skipped.
+//
+// Nets joined by assign become one net. Constants become the "<const0>" and
+// "<const1>" nets that Vivado's own GND and VCC cells drive.
+struct FuncsimNetlist {
+    struct Port {
+        std::string           name;  // "a" or "a[3]", one entry per bit
+        CompactNetlist::Index net;
+    };
+
+    std::string              top;
+    CompactNetlist           netlist;
+    std::vector<Port>        inputs;
+    std::vector<Port>        outputs;
+    std::vector<std::string> extra_params;  // per module: parameters the library does not model, and library ones left out
+
+    // The module named `top`, or the first one in the file if empty
+    static FuncsimNetlist read(const std::string& path, const Library& lib, const std::string& top = "");
+};
@@ -1,13 +1,13 @@
 #include "netlist.hpp"
+#include "packed_param.hpp"
+#include "structural_hash.hpp"
 
 #include <algorithm>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
-#include <queue>
 #include <random>
 #include <stdexcept>
-#include <unordered_set>
 #include <fstream>
 
 
@@ -19,60 +19,52 @@ std::string Net::lable(int width) const {
     return "_" + std::string(width - digit_count, '0') + std::to_string(id) + "_";
 }
 
+void Net::add_sink(Port* p, int b) {
+    p->sink_slots[b] = static_cast<std::uint32_t>(sinks.size());
+    sinks.push_back(PortBit{p, b});
+}
+
+// Swap with the last sink, whose pin learns its new slot
 void Net::remove_sink(PortBit portbit) {
-    auto it = std::remove(sinks.begin(), sinks.end(), portbit);
-    sinks.erase(it, sinks.end());
+    const std::uint32_t slot = portbit.port->sink_slots[portbit.bit];
+    if (slot >= sinks.size() || !(sinks[slot] == portbit)) return;
+
+    sinks[slot] = sinks.back();
+    sinks[slot].port->sink_slots[sinks[slot].bit] = slot;
+    sinks.pop_back();
 }
 
-Module::Module(Id module_id, const ModuleSpec& spec_ref, std::mt19937_64& rng)
-    : id{module_id}, spec{spec_ref} {
+Module::Module(Id module_id, const ModuleSpec& spec_ref, std::mt19937_64* rng, const allocator_type& alloc)
+    : id{module_id}, spec{spec_ref}, inputs(alloc), outputs(alloc), param_words(spec_ref.param_words, alloc) {
 
+    inputs.reserve(spec_ref.inputs.size());
     for (const auto& port_spec : spec_ref.inputs)
-        inputs.emplace_back(std::make_unique<Port>(port_spec, this));
+        inputs.push_back(inputs.get_allocator().new_object<Port>(port_spec, this));
 
+    outputs.reserve(spec_ref.outputs.size());
     for (const auto& port_spec : spec_ref.outputs)
-        outputs.emplace_back(std::make_unique<Port>(port_spec, this));
-
-    for (const auto& output_port : outputs)
-        if (spec_ref.seq_conns.contains(output_port->spec.name))
-            for (const auto& seq_name : spec_ref.seq_conns.at(output_port->spec.name)) {
-                Port* input_port = get_input(seq_name);
-                if (!input_port) 
-                    throw std::runtime_error("Sequential connection to non-existent input: " + seq_name);
-                seq_conns[output_port.get()].insert(input_port);
-            }
+        outputs.push_back(outputs.get_allocator().new_object<Port>(port_spec, this));
 
-    for (const auto& param_spec : spec_ref.params) {
-        std::string value;
-        value.reserve(param_spec.width);
-        for (int i = 0; i < param_spec.width; ++i)
-            value.push_back((rng() & 1) ? '1' : '0');
-        param_values.emplace(param_spec.name, std::move(value));
+    if (!rng) return;
+    for (std::size_t i = 0; i < spec_ref.params.size(); ++i) {
+        const auto& param_spec = spec_ref.params[i];
+        auto words = std::span(param_words).subspan(param_spec.offset, packed::word_count(param_spec.width));
+        packed::randomize(words, param_spec.width, *rng);
     }
 }
 
-Port* Module::get_input(const std::string& name) {
-    for (auto& input_port : inputs)
-        if (input_port->spec.name == name)
-            return input_port.get();
-    throw std::runtime_error("Input port not found: " + name);
+std::span<const std::uint64_t> Module::param(std::size_t index) const {
+    const auto& param_spec = spec.params[index];
+    return std::span(param_words).subspan(param_spec.offset, packed::word_count(param_spec.width));
 }
 
-bool Module::is_buffer() const {
-    bool correct_widths  = false;
-    bool correct_type = false;
-
-    if ((spec.inputs.size() == 1) && (spec.outputs.size() == 1)) {
-        correct_widths = spec.inputs[0].width == 1 
-                      && spec.outputs[0].width == 1;
-                      
-        correct_type  = spec.inputs[0].net_type == NetType::EXT_IN 
-                        || spec.inputs[0].net_type == NetType::EXT_CLK
-                        || spec.outputs[0].net_type == NetType::EXT_OUT;
-    }
-
+Module::~Module() {
+    for (Port* port : inputs)  inputs.get_allocator().delete_object(port);
+    for (Port* port : outputs) outputs.get_allocator().delete_object(port);
+}
 
-    return correct_widths && correct_type;
+bool Module::is_buffer() const {
+    return spec.is_buffer();
 }
 
 std::string Module::lable(int width) const {
@@ -82,7 +74,7 @@ std::string Module::lable(int width) const {
     return "_" + std::string(width - digit_count, '0') + std::to_string(id) + "_";
 }
 
-Netlist::Netlist(Library& library_ref, std::mt19937_64& rng)
+Netlist::Netlist(const Library& library_ref, std::mt19937_64& rng)
     : lib{library_ref}, rng{rng} {}
 
 void Netlist::add_initial_nets() {
@@ -90,28 +82,33 @@ void Netlist::add_initial_nets() {
     Net* clock_net = make_net(NetType::EXT_CLK, "clk");
 
     add_buffer(
-        input_net, lib.get_random_buffer(NetType::EXT_IN, NetType::LOGIC)
+        input_net, lib.get_random_buffer(rng, NetType::EXT_IN, NetType::LOGIC)
     );
     add_buffer(
-        clock_net, lib.get_random_buffer(NetType::EXT_CLK, NetType::CLK)
+        clock_net, lib.get_random_buffer(rng, NetType::EXT_CLK, NetType::CLK)
     );
 }
     
 
-Netlist::~Netlist() = default;
+Netlist::~Netlist() {
+    clear();
+}
 
 void Netlist::add_external_nets(size_t number) {
     for (size_t i = 0; i < number; ++i) {
-        Net* ext_net = make_net(NetType::EXT_IN);
+        const ModuleSpec& buffer_spec = lib.get_random_buffer(rng, NetType::EXT_IN, NetType::LOGIC);
+        if (!fits(buffer_spec, 0.5)) return;
 
-        add_buffer(
-            ext_net, lib.get_random_buffer(NetType::EXT_IN, NetType::LOGIC)
-        );
+        Net* ext_net = make_net(NetType::EXT_IN);
+        add_buffer(ext_net, buffer_spec);
     }
 }
 
+// Skipped, not redrawn, once the pick no longer fits: a full budget should
+// stop growth rather than fill up with whatever is free
 void Netlist::add_random_module() {
-    const ModuleSpec& spec_ref = lib.get_random_module();
+    const ModuleSpec& spec_ref = lib.get_random_module(rng);
+    if (!fits(spec_ref)) return;
     make_module(spec_ref);
 }
 
@@ -121,69 +118,70 @@ void Netlist::add_undriven_nets(NetType type, size_t n) {
 }
 
 void Netlist::drive_undriven_nets(double seq_mod_prob, double seq_port_prob, bool limit_to_one, NetType type) {
-    for (auto& net_ptr : nets) {
-        if (net_ptr->driver.port || net_ptr->net_type != type) continue;
+    const std::vector<Net*>& pool   = net_pools[static_cast<std::size_t>(type)];
+    std::size_t&             cursor = undriven_cursor[static_cast<std::size_t>(type)];
+
+    while (cursor < pool.size() && pool[cursor]->driver.port)
+        ++cursor;
+
+    if (!reach.built())
+        reach.build(nets);
+
+    for (std::size_t slot = cursor; slot < pool.size(); ++slot) {
+        Net* net_ptr = pool[slot];
+        if (net_ptr->driver.port) continue;
 
         std::uniform_real_distribution<double> dist(0.0, 1.0);
         bool seq_mod = dist(rng) < seq_mod_prob;
 
-        auto module_filter = [&](const ModuleSpec& ms) {
-            return ms.outputs.size() == 1 &&
-                   ms.outputs[0].net_type == type &&
-                   ms.outputs[0].width == 1 &&
-                   !(seq_mod && ms.combinational);
-        };
-
-        const ModuleSpec& driver_spec = lib.get_random_module(module_filter);
+        const ModuleSpec* driver_spec = &lib.get_random_driver(rng, type, 1, seq_mod);
+        if (!fits(*driver_spec)) {
+            auto fitting = [&](const ModuleSpec& ms) { return fits(ms); };
+            driver_spec  = lib.try_random_driver(rng, type, 1, seq_mod, fitting);
+            if (!driver_spec && seq_mod)
+                driver_spec = lib.try_random_driver(rng, type, 1, false, fitting);
+            if (!driver_spec)
+                throw std::runtime_error("No driver fits the resource budget");
+        }
 
-        Module* driver_module = make_module(driver_spec, false);
-        Port*   driver_port   = driver_module->outputs[0].get();
+        Module* driver_module = make_module(*driver_spec, false);
+        Port*   driver_port   = driver_module->outputs[0];
 
-        driver_port->nets[0] = net_ptr.get();
-        net_ptr->driver.port = driver_port;
-        net_ptr->driver.bit = 0;
+        connect_driver(driver_port, 0, net_ptr);
         
-        for (auto& input_port : driver_module->inputs) {
-
-            std::set<int> forwad_group = get_combinational_group(input_port.get(), false);
-            std::set<int> comb_group   = get_combinational_group(input_port.get(), true);
-            std::set<int> seq_group;
+        for (Port* input_port : driver_module->inputs) {
 
-            for (auto id : forwad_group)
-                if (!comb_group.contains(id))
-                    seq_group.insert(id);
+            // Nets that close a loop only through a sequential arc, only
+            // searched for once a bit of this port asks for one
+            std::vector<Net*> seq_group;
+            bool              seq_group_ready = false;
 
             for (int i = 0; i < input_port->width; ++i) {
 
                 bool seq_port = dist(rng) < seq_port_prob;
-
-                auto same_type = [&](const Net* n) {return n->net_type == input_port->net_type; };
+                Net* source   = nullptr;
 
                 if (input_port->net_type == NetType::LOGIC) {
 
-                    std::function<bool(const Net*)> seq_filter = [&](const Net* n) {
-                        return seq_group.contains(n->id) && same_type(n);
-                    };
-
-                    std::function<bool(const Net*)> comb_filter = [&](const Net* n) {
-                        return !forwad_group.contains(n->id) && same_type(n);
-                    };
-
-                    if (seq_group.empty())
-                        seq_filter = comb_filter;
-
-                    Net* source = seq_port
-                                    ?  get_random_net(seq_filter)
-                                    :  get_random_net(comb_filter);
+                    if (seq_port && !seq_group_ready) {
+                        seq_group = reach.sequential_cone(input_port);
+                        std::erase_if(seq_group, [&](const Net* n) { return n->net_type != input_port->net_type; });
+                        seq_group_ready = true;
+                    }
 
-                    input_port->nets[i] = source;
-                    source->add_sink(input_port.get(), i);
+                    if (seq_port && !seq_group.empty()) {
+                        std::uniform_int_distribution<std::size_t> pick(0, seq_group.size() - 1);
+                        source = seq_group[pick(rng)];
+                        input_port->mark_feedback(i);
+                    } else {
+                        source = get_feedforward_source(input_port);
+                    }
                 } else {
-                    Net* source = get_random_net(same_type);
-                    input_port->nets[i] = source;
-                    source->add_sink(input_port.get(), i);
+                    source = get_random_net(input_port->net_type);
                 }
 
+                connect_sink(input_port, i, source);
+                reach.add_pin(input_port, i);
             }
         }
 
@@ -193,214 +191,331 @@ void Netlist::drive_undriven_nets(double seq_mod_prob, double seq_port_prob, boo
 
 void Netlist::buffer_unconnected_outputs() {
     std::vector<Net*> logic_nets_without_sinks;
-    for (auto& net_ptr : nets)
+    for (Net* net_ptr : nets)
         if (net_ptr->sinks.empty() && net_ptr->net_type == NetType::LOGIC)
-            logic_nets_without_sinks.push_back(net_ptr.get());
+            logic_nets_without_sinks.push_back(net_ptr);
 
-    for (Net* net_ptr : logic_nets_without_sinks)
-        add_buffer(
-            net_ptr, lib.get_random_buffer(net_ptr->net_type, NetType::EXT_OUT)
-        );
+    for (Net* net_ptr : logic_nets_without_sinks) {
+        const ModuleSpec& buffer_spec = lib.get_random_buffer(rng, net_ptr->net_type, NetType::EXT_OUT);
+        if (!fits(buffer_spec)) return;
+        add_buffer(net_ptr, buffer_spec);
+    }
+}
+
+bool Netlist::fits(const ModuleSpec& spec, double share) const {
+    for (const auto& [name, count] : spec.resource) {
+        auto limit = budget.find(name);
+        if (limit == budget.end()) continue;
+        auto used = usage.find(name);
+        if ((used == usage.end() ? 0 : used->second) + count > limit->second * share)
+            return false;
+    }
+    return true;
 }
 
 void Netlist::add_buffer(Net* drive_net, const ModuleSpec& buffer_spec, bool create_output) {
-    auto buffer_module = std::make_unique<Module>(modules.size(), buffer_spec, rng);
+    Module* module_ptr = make_module(buffer_spec, false);
 
-    if (!buffer_module->is_buffer())
+    if (!module_ptr->is_buffer())
         throw std::runtime_error("Module is not a buffer");
 
-    Module* module_ptr = buffer_module.get();
-    module_ptr->id = get_next_id();
-    modules.push_back(std::move(buffer_module));
-
-    Port* input_port  = module_ptr->inputs[0].get();
-    Port* output_port = module_ptr->outputs[0].get();
+    Port* input_port  = module_ptr->inputs[0];
+    Port* output_port = module_ptr->outputs[0];
 
-    input_port->nets[0] = drive_net;
-    drive_net->add_sink(input_port, 0);
+    connect_sink(input_port, 0, drive_net);
 
     if (create_output) {
         Net* new_net = make_net(output_port->net_type);
-        output_port->nets[0]  = new_net;
-        new_net->driver   = PortBit{output_port, 0};
+        connect_driver(output_port, 0, new_net);
+        reach.add_driver(new_net);
     }
 }
 
-Module* Netlist::make_module(const ModuleSpec& spec_ref, bool connect_random, int id) {
+Module* Netlist::make_module(const ModuleSpec& spec_ref, bool connect_random, int id, bool random_params) {
     if (id < 0)
         id = get_next_id();
-    auto module_obj = std::make_unique<Module>(id, spec_ref, rng);
-    Module* module_ptr = module_obj.get();
-    modules.push_back(std::move(module_obj));
+    Module* module_ptr = alloc.new_object<Module>(id, spec_ref, random_params ? &rng : nullptr);
+    modules.push_back(module_ptr);
+    index_module(module_ptr);
+    for (const auto& [name, count] : spec_ref.resource)
+        usage[name] += count;
+    if (animation) animation->add_module(module_ptr->id, spec_ref);
 
     if (!connect_random) return module_ptr;
 
-    for (auto& input_port : module_ptr->inputs)
+    for (Port* input_port : module_ptr->inputs)
         for (int i = 0; i < input_port->width; ++i) {
-            Net* source = get_random_net(
-                [&](const Net* n) { return n->net_type == input_port->net_type; }
-            );
-            input_port->nets[i] = source;
-            source->add_sink(input_port.get(), i);
+            Net* source = get_random_net(input_port->net_type);
+            connect_sink(input_port, i, source);
         }
 
-    for (auto& output_port : module_ptr->outputs)
+    for (Port* output_port : module_ptr->outputs)
         for (int i = 0; i < output_port->width; ++i) {
             Net* dest = make_net(output_port->net_type);
-            output_port->nets[i] = dest;
-            dest->driver = PortBit{output_port.get(), i};
+            connect_driver(output_port, i, dest);
+            reach.add_driver(dest);
         }
 
     return module_ptr;
 }
 
-Net* Netlist::get_random_net(std::function<bool(const Net*)> filter) const {
+Net* Netlist::get_random_net(NetType type) const {
+    const std::vector<Net*>& pool = net_pools[static_cast<std::size_t>(type)];
+
+    if (pool.empty())
+        throw std::runtime_error("No nets of requested type");
+
+    std::uniform_int_distribution<std::size_t> dist(0, pool.size() - 1);
+    return pool[dist(rng)];
+}
+
+// Rejection sampling: uniform over the accepted nets and O(1) while they are
+// a fair share of the pool. nullptr if every attempt was rejected.
+template <typename Pred>
+Net* Netlist::try_random_net(NetType type, Pred pred, int attempts) const {
+    const std::vector<Net*>& pool = net_pools[static_cast<std::size_t>(type)];
+
+    if (pool.empty())
+        return nullptr;
+
+    std::uniform_int_distribution<std::size_t> dist(0, pool.size() - 1);
+    for (int attempt = 0; attempt < attempts; ++attempt) {
+        Net* net = pool[dist(rng)];
+        if (pred(net)) return net;
+    }
+    return nullptr;
+}
+
+template <typename Pred>
+Net* Netlist::get_random_net(NetType type, Pred pred) const {
+    constexpr int max_attempts = 16;
+    if (Net* net = try_random_net(type, pred, max_attempts))
+        return net;
+
+    const std::vector<Net*>& pool = net_pools[static_cast<std::size_t>(type)];
     std::vector<Net*> candidates;
-    for (auto& net_ptr : nets)
-        if (!filter || filter(net_ptr.get()))
-            candidates.push_back(net_ptr.get());
+    for (Net* net : pool)
+        if (pred(net))
+            candidates.push_back(net);
 
     if (candidates.empty())
         throw std::runtime_error("No nets of requested type");
 
-    std::uniform_int_distribution<std::size_t> dist(0, candidates.size() - 1);
-    return candidates[dist(rng)];
-}
-
-std::set<int> Netlist::get_combinational_group(Port* input_port, bool stop_at_seq) const {
-    std::set<int> visited;
-    std::queue<Net*> bfs_queue;
-
-    Module* module = input_port->parent;
-    for (auto& next_out : module->outputs) {
-        for (int i = 0; i < next_out->width; ++i) {
-            const bool edge_is_sequential =
-                module->seq_conns.contains(next_out.get()) &&
-                module->seq_conns.at(next_out.get()).contains(input_port);
-            
-            if (stop_at_seq && edge_is_sequential)
-                continue; 
-            
-            bfs_queue.push(next_out->nets[i]);
-        }
-    }
+    std::uniform_int_distribution<std::size_t> pick(0, candidates.size() - 1);
+    return candidates[pick(rng)];
+}
 
-    while (!bfs_queue.empty()) {
-        Net* current = bfs_queue.front();
-        bfs_queue.pop();
-        if (!visited.insert(current->id).second) continue;
-
-        for (const PortBit& sink : current->sinks) {
-            Module* module = sink.port->parent;
-
-            for (auto& next_out : module->outputs) {
-                for (int i = 0; i < next_out->width; ++i) {
-                    const bool edge_is_sequential =
-                        module->seq_conns.contains(next_out.get()) &&
-                        module->seq_conns.at(next_out.get()).contains(sink.port);
-                    
-                    if (stop_at_seq && edge_is_sequential)
-                       continue; 
-                    
-                    bfs_queue.push(next_out->nets[i]);
-                }
-            }      
-        }
-    }
-    return visited;
+// A net that can drive the port without closing any loop. Most draws are
+// settled by comparing topological orders; exhaustive cone search is the
+// fallback when a short bounded search cannot decide.
+// A source that closes no loop in the ACYCLIC or COMB layer. That is not
+// the whole forward cone: a net reached only through a feedback bit may be
+// picked, closing another loop through a sequential arc, never a
+// combinational one. The share of nets in sequential loops is unchanged.
+Net* Netlist::get_feedforward_source(Port* input_port) {
+    constexpr int max_attempts  = 16;
+    constexpr int search_budget = 128;
+
+    auto quick_filter = [&](const Net* n) {
+        return reach.closes_loop(n, input_port, Layer::ACYCLIC, search_budget) == Reach::NO
+            && reach.closes_loop(n, input_port, Layer::COMB,    search_budget) == Reach::NO;
+    };
+
+    if (Net* source = try_random_net(input_port->net_type, quick_filter, max_attempts))
+        return source;
+
+    std::vector<bool> in_cone(id_counter, false);
+    for (const Net* n : reach.loop_cone(input_port))
+        in_cone[n->id] = true;
+
+    return get_random_net(input_port->net_type, [&](const Net* n) { return !in_cone[n->id]; });
 }
 
 Net* Netlist::make_net(NetType type,const std::string& name, int id) {
     if (id < 0)
         id = get_next_id();
-    auto net_obj = std::make_unique<Net>();
-    net_obj->id = id;
-    net_obj->net_type = type;
-    net_obj->name = std::move(name);
-    Net* net_ptr  = net_obj.get();
-    nets.push_back(std::move(net_obj));
+    Net* net_ptr      = alloc.new_object<Net>();
+    net_ptr->id       = id;
+    net_ptr->net_type = type;
+    net_ptr->name     = name;
+    nets.push_back(net_ptr);
+    index_net(net_ptr);
+    net_pools[static_cast<std::size_t>(type)].push_back(net_ptr);
+    reach.add_net(net_ptr);
+    if (animation) animation->add_net(net_ptr->id, type, name);
     return net_ptr;
 }
 
-Net* Netlist::get_net(int id) {
-    for (auto& net_ptr : nets)
-        if (net_ptr->id == static_cast<size_t>(id)) return net_ptr.get();
-    throw std::runtime_error("Net not found");
+void Netlist::connect_sink(Port* port, int bit, Net* net) {
+    port->nets[bit] = net;
+    net->add_sink(port, bit);
+    if (animation) animation->connect(port->parent->id, port->spec.offset + bit, net->id);
 }
 
-void Netlist::remove_other_nets(const int& output_id) {
-    Net* out_net = get_net(output_id);
+void Netlist::connect_driver(Port* port, int bit, Net* net) {
+    port->nets[bit] = net;
+    net->driver     = PortBit{port, bit};
+    if (animation) animation->connect(port->parent->id, port->spec.offset + bit, net->id);
+}
 
-    if (out_net->net_type != NetType::EXT_OUT)
-        throw std::invalid_argument("Output net must be of type EXT_OUT");
+void Netlist::index_net(Net* net) {
+    if (net->id >= net_index.size())
+        net_index.resize(std::max<std::size_t>(net->id + 1, net_index.size() * 2), nullptr);
+    net_index[net->id] = net;
+}
+
+void Netlist::index_module(Module* module) {
+    if (module->id >= module_index.size())
+        module_index.resize(std::max<std::size_t>(module->id + 1, module_index.size() * 2), nullptr);
+    module_index[module->id] = module;
+}
 
-    std::unordered_set<int> keep_nets;
-    std::unordered_set<int> keep_modules;
-    std::queue<Net*> work;
+Net* Netlist::get_net(int id) const {
+    if (id < 0 || static_cast<std::size_t>(id) >= net_index.size() || !net_index[id])
+        throw std::runtime_error("Net not found");
+    return net_index[id];
+}
 
-    keep_nets.insert(out_net->id);
-    work.push(out_net);
+Module* Netlist::get_module(int id) const {
+    if (id < 0 || static_cast<std::size_t>(id) >= module_index.size() || !module_index[id])
+        throw std::runtime_error("Module not found");
+    return module_index[id];
+}
 
-    while (!work.empty()) {
-        Net* current = work.front();
-        work.pop();
+namespace {
 
-        if (!current->driver.port) 
-            continue;
+template <typename T>
+void free_dead(std::vector<T*>& objects, ArenaAllocator& alloc) {
+    auto live = objects.begin();
+    for (T* object : objects) {
+        if (object->dead) alloc.delete_object(object);
+        else              *live++ = object;
+    }
+    objects.erase(live, objects.end());
+}
+
+}
+
+void Netlist::remove_net(Net* net) {
+    if (net->dead) return;
+    net->dead = true;
+    net_index[net->id] = nullptr;
+    has_dead = true;
+    if (animation) animation->remove_net(net->id);
+}
+
+void Netlist::remove_module(Module* module) {
+    if (module->dead) return;
+    module->dead = true;
+    module_index[module->id] = nullptr;
+    for (const auto& [name, count] : module->spec.resource)
+        usage[name] -= count;
+    has_dead = true;
+    if (animation) animation->remove_module(module->id);
+}
+
+void Netlist::sweep() {
+    if (!has_dead) return;
 
-        Module* module = current->driver.port->parent;
+    for (auto& pool : net_pools)
+        std::erase_if(pool, [](const Net* n) { return n->dead; });
+    undriven_cursor.fill(0);
 
-        if (keep_modules.insert(module->id).second)
-            for (const auto& input_port : module->inputs)
-                for (int i = 0; i < input_port->width; ++i) 
-                    if (keep_nets.insert(input_port->nets[i]->id).second)
-                        work.push(input_port->nets[i]);
+    free_dead(modules, alloc);
+    free_dead(nets, alloc);
+    has_dead = false;
+}
 
+// Every object lives in the arena, so after running the destructors its
+// memory goes back in one release rather than object by object. With
+// keep_storage the objects are freed into the arena's pools instead, where
+// the next design's allocations find them.
+void Netlist::clear(bool keep_storage) {
+    if (keep_storage) {
+        for (Module* module : modules) alloc.delete_object(module);
+        for (Net* net : nets)          alloc.delete_object(net);
+    } else {
+        for (Module* module : modules) std::destroy_at(module);
+        for (Net* net : nets)          std::destroy_at(net);
+        arena.release();
     }
+    modules.clear();
+    nets.clear();
+
+    net_index.clear();
+    module_index.clear();
+    for (auto& pool : net_pools)
+        pool.clear();
+    undriven_cursor.fill(0);
+    reach.reset();
+    usage.clear();
+    has_dead = false;
+    if (animation) animation->clear();
+}
+
+void Netlist::reset() {
+    clear(true);
+    id_counter = 1;
+}
+
+void Netlist::remove_other_nets(const int& output_id) {
+    Net* out_net = get_net(output_id);
+
+    if (out_net->net_type != NetType::EXT_OUT)
+        throw std::invalid_argument("Output net must be of type EXT_OUT");
+
+    const CompactNetlist view = compact();
+    const auto           root = static_cast<CompactNetlist::Index>(std::find(nets.begin(), nets.end(), out_net) - nets.begin());
+
+    std::vector<bool> cone_nets;
+    std::vector<bool> cone_modules;
+    view.fanin_cone(root, cone_nets, cone_modules);
+
+    std::vector<bool> keep_nets(id_counter, false);
+    std::vector<bool> keep_modules(id_counter, false);
+    for (CompactNetlist::Index net = 0; net < view.net_count(); ++net)
+        if (cone_nets[net]) keep_nets[view.net_id(net)] = true;
+    for (CompactNetlist::Index module = 0; module < view.module_count(); ++module)
+        if (cone_modules[module]) keep_modules[view.module_id(module)] = true;
 
     for (const auto& net_ptr : nets)
         if (net_ptr->name == "clk")
-            keep_nets.insert(net_ptr->id);
-
-    for (auto& net_ptr : nets)
-        net_ptr->sinks.erase(
-            std::remove_if(net_ptr->sinks.begin(), net_ptr->sinks.end(),
-                            [&](PortBit pb) { return !keep_modules.contains(pb.port->parent->id); }),
-            net_ptr->sinks.end()
-        );
-        
-    modules.erase(
-        std::remove_if(modules.begin(), modules.end(),
-                       [&](const std::unique_ptr<Module>& m) {
-                           return !keep_modules.contains(m->id);
-                       }),
-        modules.end()
-    );
+            keep_nets[net_ptr->id] = true;
 
-    nets.erase(
-        std::remove_if(nets.begin(), nets.end(),
-                       [&](const std::unique_ptr<Net>& n) {
-                           return !keep_nets.contains(n->id);
-                       }),
-        nets.end()
-    );
+    for (Net* net_ptr : nets) {
+        std::erase_if(net_ptr->sinks, [&](PortBit pb) { return !keep_modules[pb.port->parent->id]; });
+        for (std::size_t i = 0; i < net_ptr->sinks.size(); ++i)
+            net_ptr->sinks[i].port->sink_slots[net_ptr->sinks[i].bit] = static_cast<std::uint32_t>(i);
+    }
 
+    for (Module* module_ptr : modules)
+        if (!keep_modules[module_ptr->id])
+            remove_module(module_ptr);
 
-    for (auto& module_ptr : modules) {
+    // Collect dangling outputs before the nets they point at are freed
+    std::vector<PortBit> dangling_outputs;
+    for (Module* module_ptr : modules) {
+        if (module_ptr->dead) continue;
         for (auto& port_ptr : module_ptr->inputs)
             for (int i = 0; i < port_ptr->width; ++i) 
-                if (!keep_nets.contains(port_ptr->nets[i]->id))
+                if (!keep_nets[port_ptr->nets[i]->id])
                     std::runtime_error("Input port net not found in keep set");
 
-        for (auto& port_ptr : module_ptr->outputs) {
-            for (int i = 0; i < port_ptr->width; ++i) {     
-                if (!keep_nets.contains(port_ptr->nets[i]->id)) {
-                    Net* net = make_net(port_ptr->net_type);
-                    port_ptr->nets[i] = net;
-                    net->driver = PortBit{port_ptr.get(), i};
-                }
-            }
-        }
+        for (Port* port_ptr : module_ptr->outputs)
+            for (int i = 0; i < port_ptr->width; ++i)
+                if (!keep_nets[port_ptr->nets[i]->id])
+                    dangling_outputs.push_back(PortBit{port_ptr, i});
+    }
+
+    for (Net* net_ptr : nets)
+        if (!keep_nets[net_ptr->id])
+            remove_net(net_ptr);
+    sweep();
+
+    for (const PortBit& pb : dangling_outputs) {
+        Net* net = make_net(pb.port->net_type);
+        connect_driver(pb.port, pb.bit, net);
+        reach.add_driver(net);
     }
 
     buffer_unconnected_outputs();
@@ -410,9 +525,9 @@ void Netlist::remove_other_nets(const int& output_id) {
 int Netlist::remove_random_module(std::function<bool(const Module*)> filter) {
     std::vector<Module*> candidates;
 
-    for (auto& module : modules)
-        if (!filter || filter(module.get()))
-            candidates.push_back(module.get());
+    for (Module* module : modules)
+        if (!filter || filter(module))
+            candidates.push_back(module);
 
     if (candidates.empty())
         return -1;
@@ -421,78 +536,81 @@ int Netlist::remove_random_module(std::function<bool(const Module*)> filter) {
     Module* module_to_remove = candidates[dist(rng)];
 
     int removed_id = module_to_remove->id;
+    cut_module(module_to_remove);
+    sweep();
+
+    return removed_id;
+}
+
+int Netlist::remove_modules(const std::vector<int>& ids) {
+    int removed = 0;
+    for (int id : ids) {
+        if (id < 0 || static_cast<std::size_t>(id) >= module_index.size()) continue;
+        Module* module = module_index[id];
+        if (!module || module->is_buffer()) continue;
+        cut_module(module);
+        ++removed;
+    }
+    sweep();
+    return removed;
+}
 
-    for (auto& port : module_to_remove->inputs) {
+// The module's inputs become top outputs and its outputs top inputs, so
+// what it read and what read it stay in the design
+void Netlist::cut_module(Module* module_to_remove) {
+    for (Port* port : module_to_remove->inputs) {
         for (int i = 0; i < port->width; ++i) {
             Net* net = port->nets[i];
-            net->remove_sink(PortBit{port.get(), i});
+            net->remove_sink(PortBit{port, i});
             if (net->sinks.empty() && net->net_type == NetType::LOGIC)
                 add_buffer(
-                    net, lib.get_random_buffer(net->net_type, NetType::EXT_OUT)
+                    net, lib.get_random_buffer(rng, net->net_type, NetType::EXT_OUT)
                 );
         }
     }
 
-    for (auto& port : module_to_remove->outputs) {
+    for (Port* port : module_to_remove->outputs) {
         for (int i = 0; i < port->width; ++i) {
             Net* net = port->nets[i];
             Net* new_input_net = make_net(NetType::EXT_IN);
             add_buffer(
-                new_input_net, lib.get_random_buffer(NetType::EXT_IN, NetType::LOGIC), false
+                new_input_net, lib.get_random_buffer(rng, NetType::EXT_IN, NetType::LOGIC), false
             );
             Module* module = new_input_net->sinks[0].port->parent;
-            module->outputs[0]->nets[0] = net;
-            net->driver = PortBit{module->outputs[0].get(), 0};
+            connect_driver(module->outputs[0], 0, net);
+            reach.add_driver(net);
         }
     }
 
-    modules.erase(
-        std::remove_if(modules.begin(), modules.end(),
-                       [&](const std::unique_ptr<Module>& m) {
-                           return m.get() == module_to_remove;
-                       }),
-        modules.end()
-    );
-    
-    return removed_id;
+    remove_module(module_to_remove);
 }
 
 void Netlist::remove_duplicate_outputs() {
-    std::set<int> driving_nets;
+    std::vector<bool> driven(id_counter, false);
     std::vector<Net*> nets_to_remove;
 
-    for (auto& net : nets) {
+    for (Net* net : nets) {
         if (net->net_type != NetType::EXT_OUT) continue;
 
         Module* module = net->driver.port->parent;
         Net* driving_net = module->inputs[0]->nets[0];
 
-        if (! driving_nets.insert(driving_net->id).second)
-            nets_to_remove.push_back(net.get());
+        if (driven[driving_net->id])
+            nets_to_remove.push_back(net);
+        driven[driving_net->id] = true;
     }
 
     for (Net* net : nets_to_remove) {
         Module* module = net->driver.port->parent;
         Net* driving_net = module->inputs[0]->nets[0];
 
-        driving_net->remove_sink(PortBit{module->inputs[0].get(), 0});
-
-        nets.erase(
-            std::remove_if(nets.begin(), nets.end(),
-                   [&](const std::unique_ptr<Net>& n) {
-                       return n.get() == net;
-                   }),
-            nets.end()
-        );
-
-        modules.erase(
-            std::remove_if(modules.begin(), modules.end(),
-                   [&](const std::unique_ptr<Module>& m) {
-                       return m.get() == module;
-                   }),
-            modules.end()
-        );
+        driving_net->remove_sink(PortBit{module->inputs[0], 0});
+
+        remove_net(net);
+        remove_module(module);
     }
+
+    sweep();
 }
 
 void Netlist::remove_input_output_chains() {
@@ -504,7 +622,7 @@ void Netlist::remove_input_output_chains() {
 
         if (net->driver.port->parent->is_buffer()
             && net->sinks[0].port->parent->is_buffer()) {
-                nets_to_remove.push_back(net.get());
+                nets_to_remove.push_back(net);
             }
     }
 
@@ -520,374 +638,147 @@ void Netlist::remove_input_output_chains() {
             throw std::runtime_error("Output net must be EXT_OUT and input net must be EXT_IN");
         }
 
-        nets.erase(
-            std::remove_if(nets.begin(), nets.end(),
-                   [&](const std::unique_ptr<Net>& n) {
-                       return n.get() == net || 
-                              n.get() == input_net || 
-                              n.get() == output_net;
-                   }),
-            nets.end()
-        );
-
-        modules.erase(
-            std::remove_if(modules.begin(), modules.end(),
-                   [&](const std::unique_ptr<Module>& m) {
-                       return m.get() == driver_module || 
-                              m.get() == sink_module;
-                   }),
-            modules.end()
-        );
+        remove_net(net);
+        remove_net(input_net);
+        remove_net(output_net);
+        remove_module(driver_module);
+        remove_module(sink_module);
     }
 
-    print(false);
+    sweep();
 }
 
 void Netlist::emit_verilog(std::ostream& os, const std::string& top_name) const {
-    std::vector<const Net*> top_inputs;
-    std::vector<const Net*> top_outputs;
-
-    for (const auto& net_ptr : nets) {
-        if (net_ptr->net_type == NetType::EXT_IN ||
-            net_ptr->net_type == NetType::EXT_CLK)
-            top_inputs.push_back(net_ptr.get());
-        else if (net_ptr->net_type == NetType::EXT_OUT)
-            top_outputs.push_back(net_ptr.get());
-    }
-
-    int width = id_width();
-
-    os << "module " << top_name << "(";
-    for (size_t i = 0; i < top_inputs.size(); ++i)
-        os << top_inputs[i]->lable(width)
-           << (i + 1 < top_inputs.size() ? ", " : "");
-    if (!top_outputs.empty()) os << ", ";
-    for (size_t i = 0; i < top_outputs.size(); ++i)
-        os << top_outputs[i]->lable(width)
-           << (i + 1 < top_outputs.size() ? ", " : "");
-    os << ");\n";
-
-    for (auto* net_ptr : top_inputs)
-        os << "  input  " << net_ptr->lable(width) << ";\n";
-    for (auto* net_ptr : top_outputs)
-        os << "  output " << net_ptr->lable(width) << ";\n";
-
-    for (const auto& net_ptr : nets)
-        if (net_ptr->net_type == NetType::LOGIC)
-            os << "  wire   " << net_ptr->lable(width) << ";\n";
-
-    for (const auto& module_ptr : modules) {
-        if (!module_ptr->param_values.empty()) {
-            os << "  " << module_ptr->spec.name << " #(\n";
-            for (size_t i = 0; i < module_ptr->spec.params.size(); ++i) {
-                const auto& param_spec = module_ptr->spec.params[i];
-                os << "    ." << param_spec.name << "("
-                   << param_spec.width << "'b" << module_ptr->param_values.at(param_spec.name) << ")";
-                if (i + 1 < module_ptr->spec.params.size()) os << ",";
-                os << "\n";
-            }
-            os << "  ) ";
-        } else {
-            os << "  " << module_ptr->spec.name << " ";
-        }
-
-        os << module_ptr->lable(width) << " (\n";
-
-        std::vector<Port*> ordered_ports;
-        for (const auto& port_ptr : module_ptr->inputs)  ordered_ports.push_back(port_ptr.get());
-        for (const auto& port_ptr : module_ptr->outputs) ordered_ports.push_back(port_ptr.get());
-
-        for (size_t i = 0; i < ordered_ports.size(); ++i) {
-            const Port* port_ref = ordered_ports[i];
-            os << "    ." << port_ref->spec.name << "(";
-            if (port_ref->width > 1)
-                os << "{";
-            for (int j = 0; j < port_ref->width; ++j) {
-                if (port_ref->nets[j])
-                    os << port_ref->nets[j]->lable(width);
-                else
-                    os << "1'b0"; 
-                if (j + 1 < port_ref->width) os << ", ";
-            }
-            if (port_ref->width > 1)
-                os << "}";
-            os << ")";
-            if (i + 1 < ordered_ports.size()) os << ",";
-            os << "\n";
-        }
-        os << "  );\n";
-    }
-    os << "endmodule\n";
+    compact().emit_verilog(os, top_name);
 }
 
+void Netlist::emit_dotfile(std::ostream& os, const std::string& top_name) const {
+    compact().emit_dotfile(os, top_name);
+}
 
-void Netlist::emit_dotfile(std::ostream& os, const std::string& top) const {
-    os << "digraph \"" << top << "\" {\n"
-       << "rankdir=\"LR\";\n"
-       << "remincross=true;\n";
-
-    for (const auto& m : modules) {
-
-        std::vector<std::string> in_labels;
-        std::vector<std::string> out_labels;
-        for (const auto& p : m->inputs) {
-
-            in_labels.push_back(p->spec.name);
-
-            if (p->width > 1) {
-                const std::string bus = m->lable() + "_" + p->spec.name;
-
-                os << "  " << bus << R"( [shape=record,style=rounded,label=")";
-                for (int b = p->width - 1; b >= 0; --b) {
-                    os << "<s" << b << "> " << b << ':' << b;
-                    if (b) os << " | ";
-                }
-                os << R"(",color="black",fontcolor="black"])" << ";\n";
-
-                os << "  " << bus << ":e -> "
-                   << m->lable() << ":<" << p->spec.name << ">:w "
-                   << R"([arrowhead=odiamond,arrowtail=odiamond,dir=both,)"
-                   << "style=\"setlinewidth(" << p->width
-                   << ")\",color=\"black\",fontcolor=\"black\"];\n";
-            }
-        }
-
-        for (const auto& p : m->outputs) {
-            out_labels.push_back(p->spec.name);
-
-            if (p->width > 1) {
-                const std::string bus = m->lable() + "_" + p->spec.name;
-
-                os << "  " << bus << R"( [shape=record,style=rounded,label=")";
-                for (int b = p->width - 1; b >= 0; --b) {
-                    os << "<s" << b << "> " << b << ':' << b;
-                    if (b) os << " | ";
-                }
-                os << R"(",color="black",fontcolor="black"])" << ";\n";
-
-                os << "  " << m->lable() << ":<" << p->spec.name << ">:e -> "
-                   << bus << ":w "
-                   << R"([arrowhead=odiamond,arrowtail=odiamond,dir=both,)"
-                   << "style=\"setlinewidth(" << p->width
-                   << ")\",color=\"black\",fontcolor=\"black\"];\n";
-            }
-        }
-
-        os << "  " << m->lable()
-           << R"( [shape=record,label="{{)";
-        for (std::size_t i = 0; i < in_labels.size(); ++i) {
-            os << '<' << in_labels[i] << "> " << in_labels[i];
-            if (i + 1 < in_labels.size()) os << " | ";
-        }
-        os << "} | " << m->spec.name << " | {";
-        for (std::size_t i = 0; i < out_labels.size(); ++i) {
-            os << '<' << out_labels[i] << "> " << out_labels[i];
-            if (i + 1 < out_labels.size()) os << " | ";
-        }
-        os << R"(}}",color="black",fontcolor="black"])" << ";\n";
-    }
-
-    auto edge = [&](const std::string& s, const std::string& d) {
-        os << "  " << s << " -> " << d
-           << R"( [color="black",fontcolor="black"])" << ";\n";
-    };
-
-    for (const auto& n : nets) {
-        const std::string nid = n->lable();
-
-        auto net_node = [&](const char* shape) {
-            os << "  " << nid << " [shape=" << shape
-               << ",label=\"" << nid
-               << R"(",color="black",fontcolor="black"])" << ";\n";
-        };
+nlohmann::json Netlist::json() const {
+    return compact().json();
+}
 
-        switch (n->net_type) {
-        case NetType::EXT_IN:
-        case NetType::EXT_CLK: net_node("octagon"); break;
-        case NetType::EXT_OUT: net_node("octagon"); break;
-        default:               net_node("diamond"); break;
-        }
+CompactNetlist Netlist::compact() const {
+    CompactNetlist::Builder compact;
+    std::vector<CompactNetlist::Index> by_id(id_counter, CompactNetlist::NONE);
 
-        if (n->driver.port) {
-            const Port* dp = n->driver.port;
-            std::string src = (dp->width == 1)
-                ? dp->parent->lable() + ":<" + dp->spec.name + '>'
-                : dp->parent->lable() + '_' + dp->spec.name
-                    + ":<s" + std::to_string(n->driver.bit) + '>';
+    for (const Net* net_ptr : nets)
+        by_id[net_ptr->id] = compact.add_net(net_ptr->id, net_ptr->net_type, net_ptr->name);
 
-            edge(src, nid + ":w");
-        }
+    for (const Module* module_ptr : modules) {
+        const auto module = compact.add_module(module_ptr->id, module_ptr->spec);
 
-        for (const PortBit& s : n->sinks) {
-            const Port* sp = s.port;
-            std::string dst = (sp->width == 1)
-                ? sp->parent->lable() + ":<" + sp->spec.name + '>'
-                : sp->parent->lable() + '_' + sp->spec.name
-                    + ":<s" + std::to_string(s.bit) + ">:w";
+        auto pin = compact.first_pin(module);
+        for (const auto* ports : {&module_ptr->inputs, &module_ptr->outputs})
+            for (const Port* port_ptr : *ports)
+                for (int i = 0; i < port_ptr->width; ++i, ++pin)
+                    if (port_ptr->nets[i])
+                        compact.connect(pin, by_id[port_ptr->nets[i]->id]);
 
-            edge(nid + ":e", dst);
-        }
+        for (std::size_t i = 0; i < module_ptr->spec.params.size(); ++i)
+            compact.set_param(module, i, module_ptr->param(i));
     }
 
-    os << "}\n";
+    compact.set_next_id(id_counter);
+    return compact.finalize();
 }
 
-nlohmann::json Netlist::json() const {
-
-    nlohmann::json json_netlist;
-    json_netlist["version"] = "0.1";
-
+void Netlist::load_from_json(const nlohmann::json& json_netlist) {
+    load(CompactNetlist::from_json(json_netlist, lib));
+}
 
-    json_netlist["nets"] = nlohmann::json::array();
-    
-    for (const auto& net_ptr : nets) {
-        nlohmann::json net_json;
-        net_json["id"] = net_ptr->id;
-        net_json["name"] = net_ptr->name;
-        net_json["type"] = static_cast<int>(net_ptr->net_type);
-        json_netlist["nets"].push_back(net_json);
-    }
+void Netlist::load(const CompactNetlist& compact) {
 
-    json_netlist["modules"] = nlohmann::json::array();
-    for (const auto& module_ptr : modules) {
-        nlohmann::json module_json;
-        module_json["id"] = module_ptr->id;
-        module_json["name"] = module_ptr->spec.name;
-
-        auto port_to_json = [](const Port* port) {
-            nlohmann::json port_json;
-            port_json["width"] = port->spec.width;
-            port_json["net_type"] = static_cast<int>(port->net_type);
-            port_json["net_ids"] = nlohmann::json::array();
-            for (int i = 0; i < port->width; ++i) {
-                if (port->nets[i])
-                    port_json["net_ids"].push_back(port->nets[i]->id);
-                else
-                    port_json["net_ids"].push_back(-1);
-            } 
-            return port_json;
-        };
-
-        for (const auto& port_ptr : module_ptr->inputs) 
-            module_json["ports"][port_ptr->spec.name] = port_to_json(port_ptr.get());
-
-        for (const auto& port_ptr : module_ptr->outputs) 
-            module_json["ports"][port_ptr->spec.name] = port_to_json(port_ptr.get());
-
-        module_json["params"] = nlohmann::json::object();
-        for (const auto& param : module_ptr->param_values) {
-            module_json["params"][param.first] = param.second;
-        }
+    clear();
+    id_counter = std::max<int>(id_counter, compact.next_id());
 
-        json_netlist["modules"].push_back(module_json);
+    std::vector<Net*> by_index;
+    by_index.reserve(compact.net_count());
+    for (CompactNetlist::Index net = 0; net < compact.net_count(); ++net)
+        by_index.push_back(make_net(compact.net_type(net), std::string(compact.net_name(net)), compact.net_id(net)));
 
-    }
+    std::uint64_t param_bits = 0;
+    for (CompactNetlist::Index module = 0; module < compact.module_count(); ++module) {
+        const ModuleSpec& spec = compact.module_spec(module);
+        Module* module_ptr = make_module(spec, false, compact.module_id(module), false);
 
-    return json_netlist;
-}
+        auto pin = compact.first_pin(module);
+        for (Port* port_ptr : module_ptr->inputs)
+            for (int i = 0; i < port_ptr->width; ++i, ++pin)
+                if (compact.pin_net(pin) != CompactNetlist::NONE)
+                    connect_sink(port_ptr, i, by_index[compact.pin_net(pin)]);
 
-void Netlist::load_from_json(const nlohmann::json& json_netlist) {
+        for (Port* port_ptr : module_ptr->outputs)
+            for (int i = 0; i < port_ptr->width; ++i, ++pin)
+                if (compact.pin_net(pin) != CompactNetlist::NONE)
+                    connect_driver(port_ptr, i, by_index[compact.pin_net(pin)]);
 
-    nets.clear();
-    modules.clear();
-
-    for (const auto& net_json : json_netlist["nets"]) {
-        std::string name = net_json.value("name", "");
-        int id = net_json.value("id", -1);
-        id_counter = std::max(id_counter, id + 1);
-        if (id < 0) {
-            throw std::runtime_error("Invalid net ID in JSON: " + std::to_string(id));
+        for (std::size_t i = 0; i < spec.params.size(); ++i) {
+            std::ranges::copy(compact.param(module, i), module_ptr->param_words.begin() + spec.params[i].offset);
+            param_bits += static_cast<std::uint64_t>(spec.params[i].width);
         }
-        NetType type = static_cast<NetType>(net_json.value("type", -1));
-        make_net(type, name, id);
     }
 
-    for (const auto& module_json : json_netlist["modules"]) {
-        int id = module_json.value("id", -1);
-        id_counter = std::max(id_counter, id + 1);
-        if (id < 0) {
-            throw std::runtime_error("Invalid module ID in JSON: " + std::to_string(id));
-        }
-        std::string name = module_json.value("name", "");
-        const ModuleSpec& spec = lib.get_module(name);
-        Module* module_ptr = make_module(spec, false, id);
-
-        for (auto& port_ptr : module_ptr->inputs) {
-            auto port_json = module_json["ports"][port_ptr->spec.name];
-            for (int i = 0; i < port_ptr->width; ++i) {           
-                int net_id = port_json["net_ids"][i];
-                if (net_id >= 0) {
-                    Net* net = get_net(net_id);
-                    port_ptr->nets[i] = net;
-                    net->add_sink(port_ptr.get(), i);
-                }
-            }
-        }
-
-        for (auto& port_ptr : module_ptr->outputs) {
-            auto port_json = module_json["ports"][port_ptr->spec.name];
-            for (int i = 0; i < port_ptr->width; ++i) {
-                int net_id = port_json["net_ids"][i];
-                if (net_id >= 0) {
-                    Net* net = get_net(net_id);
-                    port_ptr->nets[i] = net;
-                    net->driver = PortBit{port_ptr.get(), i};
-                }
-            }
-        }
+    // Loading used to draw a bit per parameter bit, since overwritten; skip
+    // the same stretch of the stream so reductions pick the same modules
+    rng.discard(param_bits);
+}
 
-        for (const auto& param : module_json["params"].items()) {
-            module_ptr->param_values[param.key()] = param.value();
-        }
+void NetlistStats::print(std::ostream& os) const {
+    os << "+--------------------+-------+\n"
+       << "| Metric             | Count |\n"
+       << "+--------------------+-------+\n"
+       << "| Input nets         | " << std::setw(5) << input_nets     << " |\n"
+       << "| Output nets        | " << std::setw(5) << output_nets    << " |\n"
+       << "| Total nets         | " << std::setw(5) << total_nets     << " |\n"
+       << "| Combinational mods | " << std::setw(5) << comb_modules   << " |\n"
+       << "| Sequential mods    | " << std::setw(5) << seq_modules    << " |\n"
+       << "| Total modules      | " << std::setw(5) << total_modules  << " |\n";
+
+    for (const auto& [name, used] : resources) {
+        auto        limit = budget.find(name);
+        std::string label = limit == budget.end() ? name : name + " / " + std::to_string(limit->second);
+        label.resize(std::max<std::size_t>(label.size(), 18), ' ');
+        os << "| " << label << " | " << std::setw(5) << used << " |\n";
     }
+    os << "+--------------------+-------+\n";
 }
 
-    
-
-void Netlist::print(bool only_stats) const
+void Netlist::print(bool only_stats, std::ostream& os) const
 {
-    const NetlistStats stats = get_stats();
-
-    std::cout << "+--------------------+-------+\n"
-              << "| Metric             | Count |\n"
-              << "+--------------------+-------+\n"
-              << "| Input nets         | " << std::setw(5) << stats.input_nets     << " |\n"
-              << "| Output nets        | " << std::setw(5) << stats.output_nets    << " |\n"
-              << "| Total nets         | " << std::setw(5) << stats.total_nets     << " |\n"
-              << "| Combinational mods | " << std::setw(5) << stats.comb_modules   << " |\n"
-              << "| Sequential mods    | " << std::setw(5) << stats.seq_modules    << " |\n"
-              << "| Total modules      | " << std::setw(5) << stats.total_modules  << " |\n"
-              << "+--------------------+-------+\n";
+    get_stats().print(os);
 
     if (only_stats) return;
 
     /* Detailed listing -- every port, every bit */
     for (const auto& mod : modules) {
-        std::cout << "Module #" << mod->id << " (" << mod->spec.name << ")\n";
+        os << "Module #" << mod->id << " (" << mod->spec.name << ")\n";
 
         auto dump_port =
-            [](const char* dir, const Port* p) {
-                std::cout << "    " << dir << ' '
-                          << std::setw(12) << p->spec.name << "  ";
+            [&os](const char* dir, const Port* p) {
+                os << "    " << dir << ' '
+                   << std::setw(12) << p->spec.name << "  ";
 
                 if (p->width == 1) {
                     const Net* n = p->nets[0];
-                    std::cout << "net " << std::setw(4)
-                              << (n ? std::to_string(n->id) : "-")
-                              << " (" << static_cast<int>(p->net_type) << ")\n";
+                    os << "net " << std::setw(4)
+                       << (n ? std::to_string(n->id) : "-")
+                       << " (" << static_cast<int>(p->net_type) << ")\n";
                 } else {
-                    std::cout << "nets [ ";
+                    os << "nets [ ";
                     for (int i = 0; i < p->width; ++i) {
                         const Net* n = p->nets[i];
-                        std::cout << (n ? std::to_string(n->id) : "-");
-                        if (i + 1 < p->width) std::cout << ' ';
+                        os << (n ? std::to_string(n->id) : "-");
+                        if (i + 1 < p->width) os << ' ';
                     }
-                    std::cout << "] (" << static_cast<int>(p->net_type) << ")\n";
+                    os << "] (" << static_cast<int>(p->net_type) << ")\n";
                 }
             };
 
-        for (const auto& in  : mod->inputs)  dump_port("in ", in .get());
-        for (const auto& out : mod->outputs) dump_port("out", out.get());
+        for (const Port* in  : mod->inputs)  dump_port("in ", in);
+        for (const Port* out : mod->outputs) dump_port("out", out);
     }
 }
 
@@ -899,31 +790,19 @@ NetlistStats Netlist::get_stats() const {
         
     stats.total_nets = static_cast<int>(nets.size());
 
-    for (const auto& module_ptr : modules)
+    for (const auto& module_ptr : modules) {
         if   (module_ptr->spec.combinational) ++stats.comb_modules;
         else                                  ++stats.seq_modules;
+        ++stats.primitives[module_ptr->spec.name];
+    }
 
     stats.total_modules = static_cast<int>(modules.size());
+    stats.resources     = usage;
+    stats.budget        = budget;
 
     return stats;
 }
 
-int Netlist::get_fingerprint() const {
-    std::map<std::string, int> net_type_count;
-    
-    for (const auto& module_ptr : modules) {
-        if (!module_ptr->is_buffer()) {
-            const std::string& name = module_ptr->spec.name;
-            net_type_count[name]++;
-        }
-    }
-
-    std::ostringstream oss;
-    for (const auto& [name, count] : net_type_count) {
-        oss << name << ":" << count << ";";
-    }
-
-    std::hash<std::string> hasher;
-
-    return static_cast<int>(hasher(oss.str()) % std::numeric_limits<int>::max());
+std::uint64_t Netlist::get_fingerprint() const {
+    return structural_hash(compact());
 }
\ No newline at end of file
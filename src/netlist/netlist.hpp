@@ -1,13 +1,20 @@
 #pragma once
 
+#include "animation_log.hpp"
+#include "compact_netlist.hpp"
 #include "library.hpp"
 #include "module.hpp"
+#include "reachability.hpp"
 
+#include <array>
 #include <cassert>
 #include <cmath>
+#include <iostream>
 #include <memory>
+#include <memory_resource>
 #include <random>
 #include <set>
+#include <span>
 #include <map>
 #include <functional>
 #include <vector>
@@ -26,46 +33,77 @@ struct PortBit {
     }
 };
 
+// Nets, ports and modules are allocated from their netlist's arena, see
+// Netlist::arena. Their containers draw from the same allocator.
+using ArenaAllocator = std::pmr::polymorphic_allocator<>;
+
 struct Net {
-    Id                   id;
-    std::string          name;
-    NetType              net_type{NetType::LOGIC};
-    PortBit              driver;
-    std::vector<PortBit> sinks;
+    using allocator_type = ArenaAllocator;
+
+    Id                         id;
+    std::string                name;
+    NetType                    net_type{NetType::LOGIC};
+    PortBit                    driver;
+    std::pmr::vector<PortBit>  sinks;      // unordered, see Port::sink_slots
+    bool                       dead{false};
+
+    explicit Net(const allocator_type& alloc = {}) : sinks(alloc) {}
 
     std::string lable(int width = 0) const;
 
-    void add_sink   (Port* p, int b) { sinks.push_back(PortBit{p, b}); }
+    void add_sink   (Port* p, int b);
     void remove_sink(PortBit p);
 };
 
 struct Port {
-    const PortSpec&         spec;
-    Module*                 parent{nullptr};
-    std::vector<Net*>       nets; 
-    int                     width{1};
-    NetType                 net_type;
-
-    Port(const PortSpec& s, Module* m) : spec{s}, parent{m}, nets(s.width, nullptr), width(s.width), net_type{s.net_type} {
+    using allocator_type = ArenaAllocator;
+
+    const PortSpec&                 spec;
+    Module*                         parent{nullptr};
+    std::pmr::vector<Net*>          nets; 
+    int                             width{1};
+    NetType                         net_type;
+    std::pmr::vector<bool>          feedback;    // input bits deliberately closing a sequential loop, empty if none
+    std::pmr::vector<std::uint32_t> sink_slots;  // input bits: index of this pin in its net's sinks
+
+    Port(const PortSpec& s, Module* m, const allocator_type& alloc = {})
+        : spec{s}, parent{m}, nets(s.width, nullptr, alloc), width(s.width), net_type{s.net_type}, feedback(alloc),
+          sink_slots(s.port_dir == PortDir::INPUT ? s.width : 0, 0, alloc) {
         assert(m && s.width > 0);
     };
 
     bool is_input () const { return spec.port_dir == PortDir::INPUT; }
     bool is_output() const { return spec.port_dir == PortDir::OUTPUT; }
+
+    bool is_feedback  (int bit) const { return !feedback.empty() && feedback[bit]; }
+    void mark_feedback(int bit) {
+        if (feedback.empty()) feedback.resize(width, false);
+        feedback[bit] = true;
+    }
 };
 
 struct Module {
+    using allocator_type = ArenaAllocator;
+
     Id                                           id;
     const ModuleSpec&                            spec;
-    std::vector<std::unique_ptr<Port>>           inputs;
-    std::vector<std::unique_ptr<Port>>           outputs;
-    std::map<Port*, std::set<Port*>>             seq_conns;
-    std::map<std::string, std::string>           param_values;
+    std::pmr::vector<Port*>                      inputs;    // owned, allocated with this module
+    std::pmr::vector<Port*>                      outputs;
+    std::pmr::vector<std::uint64_t>              param_words;  // packed, laid out by the spec
+    bool                                         dead{false};
+
+    // Parameters drawn from `rng`, or left zero for the caller to fill if null
+    Module(Id id_, const ModuleSpec& ms, std::mt19937_64* rng, const allocator_type& alloc = {});
+    ~Module();
+    Module(const Module&)            = delete;
+    Module& operator=(const Module&) = delete;
 
-    Module(Id id_, const ModuleSpec& ms, std::mt19937_64& rng);
-    Port* get_input(const std::string& name); 
     std::string lable(int width = 0) const;
     bool is_buffer() const;
+    std::span<const std::uint64_t> param(std::size_t index) const;
+    bool is_seq_arc(const Port* output, const Port* input) const {
+        return spec.is_seq_arc(output->spec.index, input->spec.index);
+    }
 };
 
 struct NetlistStats {
@@ -75,12 +113,20 @@ struct NetlistStats {
     int comb_modules    = 0;
     int seq_modules     = 0;
     int total_modules   = 0;
+
+    ResourceCounts             resources;   // used by the modules
+    ResourceCounts             budget;      // limits generation kept to, if any
+    std::map<std::string, int> primitives;  // instances per module name
+
+    void print(std::ostream& os = std::cout) const;
 };
 
 class Netlist {
 public:
-    Netlist(Library& lib, std::mt19937_64& rng);
+    Netlist(const Library& lib, std::mt19937_64& rng);
     ~Netlist();
+    Netlist(const Netlist&)            = delete;
+    Netlist& operator=(const Netlist&) = delete;
 
     void add_initial_nets();
     void add_random_module();
@@ -91,10 +137,14 @@ public:
 
     void remove_other_nets(const int& output_id);
     int  remove_random_module(std::function<bool(const Module*)> filter = nullptr);
+    // Removes the modules of `ids` that exist and are not IO buffers, each
+    // as remove_random_module does; returns how many
+    int  remove_modules(const std::vector<int>& ids);
     void remove_duplicate_outputs();
     void remove_input_output_chains();
 
-    int get_fingerprint() const;
+    // Structural hash, see structural_hash
+    std::uint64_t get_fingerprint() const;
 
     void emit_verilog(std::ostream& os, const std::string& top_name = "top") const;
     void emit_dotfile(std::ostream& os, const std::string& top_name = "top") const;
@@ -102,24 +152,82 @@ public:
     nlohmann::json  json() const;
     void            load_from_json(const nlohmann::json& json_netlist);
 
-    void print(bool only_stats = true) const;
+    CompactNetlist  compact() const;
+    void            load(const CompactNetlist& compact);
+
+    // Back to an empty netlist with fresh ids, keeping the arena's memory
+    // for the next design
+    void            reset();
+
+    void print(bool only_stats = true, std::ostream& os = std::cout) const;
     NetlistStats get_stats() const;
+
+    // Generation adds no module that would take a resource past its limit
+    // here; resources not named are unlimited. Initial nets are exempt, and
+    // undriven nets still get a driver, one that fits if any does. External
+    // inputs may take only half of a limit, keeping room for the outputs.
+    void set_budget(const ResourceCounts& limits) { budget = limits; }
+    bool fits      (const ModuleSpec& spec, double share = 1.0) const;
+
+    // Every later edit is also recorded in `log`, nullptr to stop
+    void set_animation_log(AnimationLog* log) { animation = log; }
     
 private:
     void          add_buffer(Net* net, const ModuleSpec& buffer, bool create_output = true);
-    Net*          get_random_net(std::function<bool(const Net*)> filter = nullptr) const;
+    Net*          get_random_net(NetType type) const;
+    template <typename Pred>
+    Net*          get_random_net(NetType type, Pred pred) const;
+    template <typename Pred>
+    Net*          try_random_net(NetType type, Pred pred, int attempts) const;
+    Net*          get_feedforward_source(Port* input_port);
     Net*          make_net(NetType type, const std::string& name = "", int id = -1);
-    std::set<int> get_combinational_group(Port* input_port, bool stop_at_seq = true) const;
-    Module*       make_module(const ModuleSpec& ms, bool connect_random = true, int id = -1);
-
-    int  get_next_id() { return id_counter++; }
-    int  id_width() const { return static_cast<int>(std::log10(id_counter)) + 1; }
-    Net* get_net(int id);
-
-    std::vector<std::unique_ptr<Module>> modules;
-    std::vector<std::unique_ptr<Net>>    nets;
-
-    Library&                    lib;
+    Module*       make_module(const ModuleSpec& ms, bool connect_random = true, int id = -1, bool random_params = true);
+    void          connect_sink  (Port* port, int bit, Net* net);
+    void          connect_driver(Port* port, int bit, Net* net);
+
+    int     get_next_id() { return id_counter++; }
+    int     id_width() const { return static_cast<int>(std::log10(id_counter)) + 1; }
+    Net*    get_net(int id) const;
+    Module* get_module(int id) const;
+
+    void    index_net   (Net* net);
+    void    index_module(Module* module);
+
+    // Removal only marks the object dead; sweep() frees the dead ones once
+    // per pass, keeping the order of the survivors
+    void    remove_net   (Net* net);
+    void    remove_module(Module* module);
+    void    cut_module   (Module* module);
+    void    sweep();
+    void    clear(bool keep_storage = false);
+
+    // Backing store for every net, module and port of this netlist. Objects
+    // keep their address for life; clear() drops them all at once.
+    std::pmr::unsynchronized_pool_resource arena;
+    ArenaAllocator                         alloc{&arena};
+
+    std::vector<Module*>                 modules;
+    std::vector<Net*>                    nets;
+
+    // Dense id -> object tables, nullptr for ids that are free or belong to
+    // the other kind (nets and modules share one id counter).
+    std::vector<Net*>                    net_index;
+    std::vector<Module*>                 module_index;
+
+    // Live nets of each type in creation order, so random picks need no
+    // scan. undriven_cursor[t] is a position in net_pools[t] before which
+    // every net already has a driver.
+    std::array<std::vector<Net*>, NET_TYPE_COUNT> net_pools;
+    std::array<std::size_t, NET_TYPE_COUNT>       undriven_cursor{};
+
+    ReachabilityIndex                    reach;
+    bool                                 has_dead{false};
+
+    ResourceCounts                       budget;
+    ResourceCounts                       usage;     // of the live modules
+
+    const Library&              lib;
     std::mt19937_64&            rng;
     int                         id_counter{1};
+    AnimationLog*               animation{nullptr};
 };
@@ -0,0 +1,512 @@
+#include "netlist_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char          SNAPSHOT_MAGIC[8] = {'F', 'Z', 'N', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t BYTE_ORDER_MARK   = 0x01020304;
+
+struct FileHeader {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t section_count;
+    std::uint32_t reserved;
+};
+
+struct SectionEntry {
+    char          name[8];
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+// Read-only private mapping of a whole file, unmapped with the last owner
+std::shared_ptr<const void> map_file(const std::string& path, std::size_t& size) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Could not open snapshot: " + path);
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        ::close(fd);
+        throw std::runtime_error("Truncated snapshot: " + path);
+    }
+    size = static_cast<std::size_t>(st.st_size);
+
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw std::runtime_error("Could not map snapshot: " + path);
+
+    return std::shared_ptr<const void>(data, [size](const void* p) { ::munmap(const_cast<void*>(p), size); });
+}
+
+NetlistFile load_snapshot(const std::string& path, const Library& lib) {
+    std::size_t size = 0;
+    auto mapping = map_file(path, size);
+    std::span<const std::byte> bytes(static_cast<const std::byte*>(mapping.get()), size);
+
+    FileHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        throw std::runtime_error("Not a fuznet snapshot: " + path);
+    if (header.byte_order != BYTE_ORDER_MARK)
+        throw std::runtime_error("Snapshot written on a machine of the other byte order: " + path);
+    if (header.version != NetlistFile::SNAPSHOT_VERSION)
+        throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version) + ": " + path);
+
+    const std::size_t table_end = sizeof(FileHeader) + std::size_t{header.section_count} * sizeof(SectionEntry);
+    if (table_end > size)
+        throw std::runtime_error("Truncated snapshot: " + path);
+
+    std::optional<std::span<const std::byte>> meta, current, previous;
+    for (std::uint32_t i = 0; i < header.section_count; ++i) {
+        SectionEntry entry;
+        std::memcpy(&entry, bytes.data() + sizeof(FileHeader) + i * sizeof(SectionEntry), sizeof(entry));
+        if (entry.offset > size || entry.size > size - entry.offset)
+            throw std::runtime_error("Truncated snapshot: " + path);
+
+        const auto section = bytes.subspan(entry.offset, entry.size);
+        const std::string_view name(entry.name, strnlen(entry.name, sizeof(entry.name)));
+        if      (name == "meta") meta     = section;
+        else if (name == "new")  current  = section;
+        else if (name == "old")  previous = section;
+    }
+    if (!current)
+        throw std::runtime_error("Snapshot has no netlist: " + path);
+
+    NetlistFile file;
+    if (meta)
+        file.meta = nlohmann::json::parse(reinterpret_cast<const char*>(meta->data()),
+                                          reinterpret_cast<const char*>(meta->data() + meta->size()));
+    file.current = CompactNetlist::map(*current, lib, mapping);
+    if (previous)
+        file.previous = CompactNetlist::map(*previous, lib, mapping);
+    return file;
+}
+
+// One "new" or "old" netlist fed to a Builder as its fields stream past.
+// A module is held until its object closes, since its fields may come in any
+// order; its pins keep net ids until the end, since nets follow modules.
+class NetlistReader {
+public:
+    explicit NetlistReader(const Library& lib) : lib(lib) {}
+
+    struct Net {
+        std::int64_t id{-1};
+        std::int64_t type{-1};
+        std::string  name;
+    };
+    struct Module {
+        struct Port {
+            std::string               name;
+            std::vector<std::int64_t> net_ids;
+        };
+
+        std::int64_t                                     id{-1};
+        std::string                                      name;
+        std::vector<std::pair<std::string, std::string>> params;
+        std::vector<Port>                                ports;
+        std::size_t                                      param_count{0};
+        std::size_t                                      port_count{0};
+
+        std::string& add_param(std::string& param_name) {
+            if (param_count == params.size()) params.emplace_back();
+            params[param_count].first.swap(param_name);
+            return params[param_count++].second;
+        }
+        Port& add_port(const std::string& port_name) {
+            if (port_count == ports.size()) ports.emplace_back();
+            ports[port_count].name = port_name;
+            ports[port_count].net_ids.clear();
+            return ports[port_count++];
+        }
+    };
+
+    Net    net;
+    Module module;
+
+    void begin_net()    { net.id = -1; net.type = -1; net.name.clear(); }
+    void begin_module() { module.id = -1; module.name.clear(); module.param_count = module.port_count = 0; }
+
+    void end_net() {
+        if (net.id < 0 || net.id >= CompactNetlist::NONE)
+            throw std::runtime_error("Invalid net ID in JSON: " + std::to_string(net.id));
+
+        const auto id = static_cast<std::size_t>(net.id);
+        if (id >= by_id.size())
+            by_id.resize(std::max<std::size_t>(id + 1, by_id.size() * 2), CompactNetlist::NONE);
+        by_id[id] = builder.add_net(static_cast<std::uint32_t>(net.id), static_cast<NetType>(net.type), net.name);
+    }
+
+    void end_module() {
+        if (module.id < 0 || module.id >= CompactNetlist::NONE)
+            throw std::runtime_error("Invalid module ID in JSON: " + std::to_string(module.id));
+        const ModuleSpec&           spec  = lib.get_module(module.name);
+        const CompactNetlist::Index index = builder.add_module(static_cast<std::uint32_t>(module.id), spec);
+
+        auto connect_port = [&](const PortSpec& port) {
+            const auto ports = std::span(module.ports).first(module.port_count);
+            auto it = std::ranges::find(ports, port.name, &Module::Port::name);
+            if (it == ports.end())
+                throw std::runtime_error("Missing port " + port.name + " on module " + spec.name);
+            if (it->net_ids.size() < static_cast<std::size_t>(port.width))
+                throw std::runtime_error("Too few net IDs for port " + port.name + " on module " + spec.name);
+
+            for (int i = 0; i < port.width; ++i)
+                pin_net_ids.push_back(it->net_ids[i] < 0 ? CompactNetlist::NONE
+                                                         : static_cast<std::uint32_t>(std::min<std::int64_t>(it->net_ids[i], CompactNetlist::NONE - 1)));
+        };
+        for (const auto& port : spec.inputs)  connect_port(port);
+        for (const auto& port : spec.outputs) connect_port(port);
+
+        const auto params = std::span(module.params).first(module.param_count);
+        for (std::size_t i = 0; i < spec.params.size(); ++i) {
+            auto it = std::ranges::find(params, spec.params[i].name, &std::pair<std::string, std::string>::first);
+            if (it == params.end())
+                throw std::runtime_error("Missing parameter " + spec.params[i].name + " on module " + spec.name);
+            builder.set_param(index, i, it->second);
+        }
+    }
+
+    CompactNetlist finish() {
+        for (CompactNetlist::Index pin = 0; pin < pin_net_ids.size(); ++pin) {
+            const std::uint32_t net_id = pin_net_ids[pin];
+            if (net_id == CompactNetlist::NONE)
+                continue;
+            if (net_id >= by_id.size() || by_id[net_id] == CompactNetlist::NONE)
+                throw std::runtime_error("Net not found");
+            builder.connect(pin, by_id[net_id]);
+        }
+        return builder.finalize();
+    }
+
+private:
+    const Library&                     lib;
+    CompactNetlist::Builder            builder;
+    std::vector<CompactNetlist::Index> by_id;
+    std::vector<std::uint32_t>         pin_net_ids;  // net id per pin in builder order, NONE if open
+};
+
+// SAX handler for a whole netlist file. "new" and "old" go through
+// NetlistReader; every other top-level key is small and kept as DOM in meta.
+class JsonFileReader : public nlohmann::json_sax<nlohmann::json> {
+public:
+    JsonFileReader(const std::string& path, const Library& lib) : path(path), lib(lib) {}
+
+    NetlistFile take() {
+        if (!current)
+            throw std::runtime_error("Netlist file has no \"new\" netlist: " + path);
+        file.current = std::move(*current);
+        return std::move(file);
+    }
+
+    bool null() override                                      { return other(nullptr); }
+    bool boolean(bool value) override                         { return other(value); }
+    bool number_float(number_float_t value, const string_t&) override { return other(value); }
+    bool binary(binary_t& value) override                     { return other(nlohmann::json::binary(value)); }
+    bool number_integer(number_integer_t value) override      { return integer(value); }
+    bool number_unsigned(number_unsigned_t value) override {
+        return integer(static_cast<std::int64_t>(std::min<number_unsigned_t>(value, INT64_MAX)));
+    }
+
+    bool string(string_t& value) override { return text(value); }
+    bool key   (string_t& value) override { current_key.swap(value); return true; }
+
+    bool start_object(std::size_t) override { return open(true); }
+    bool start_array (std::size_t) override { return open(false); }
+    bool end_object() override              { return close(); }
+    bool end_array () override              { return close(); }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) override {
+        throw std::runtime_error("Invalid JSON in " + path + ": " + e.what());
+    }
+
+private:
+    enum class Ctx { File, Meta, Netlist, Nets, Net, Modules, Module, Params, Ports, Port, NetIds, Skip };
+
+    [[noreturn]] void unexpected() const {
+        throw std::runtime_error("Unexpected value for \"" + current_key + "\" in netlist file: " + path);
+    }
+
+    bool open(bool object) {
+        if (stack.empty()) {
+            if (!object) unexpected();
+            stack.push_back(Ctx::File);
+            return true;
+        }
+
+        Ctx ctx = Ctx::Skip;
+        switch (stack.back()) {
+            case Ctx::File:
+                if (current_key == "new" || current_key == "old") {
+                    if (!object) unexpected();
+                    netlist.emplace(lib);
+                    netlist_is_new = current_key == "new";
+                    ctx = Ctx::Netlist;
+                    break;
+                }
+                [[fallthrough]];
+            case Ctx::Meta:
+                meta_stack.push_back(&meta_slot(object ? nlohmann::json::object() : nlohmann::json::array()));
+                ctx = Ctx::Meta;
+                break;
+            case Ctx::Netlist:
+                if      (current_key == "nets"    && !object) ctx = Ctx::Nets;
+                else if (current_key == "modules" && !object) ctx = Ctx::Modules;
+                break;
+            case Ctx::Nets:
+                if (!object) unexpected();
+                netlist->begin_net();
+                ctx = Ctx::Net;
+                break;
+            case Ctx::Modules:
+                if (!object) unexpected();
+                netlist->begin_module();
+                ctx = Ctx::Module;
+                break;
+            case Ctx::Module:
+                if      (current_key == "params" && object) ctx = Ctx::Params;
+                else if (current_key == "ports"  && object) ctx = Ctx::Ports;
+                else if (current_key == "id" || current_key == "name" || current_key == "params" || current_key == "ports") unexpected();
+                break;
+            case Ctx::Ports:
+                if (!object) unexpected();
+                port = &netlist->module.add_port(current_key);
+                ctx  = Ctx::Port;
+                break;
+            case Ctx::Port:
+                if (current_key == "net_ids") {
+                    if (object) unexpected();
+                    ctx = Ctx::NetIds;
+                }
+                break;
+            case Ctx::Net:
+                if (current_key == "id" || current_key == "name" || current_key == "type") unexpected();
+                break;
+            case Ctx::Params:
+            case Ctx::NetIds:
+                unexpected();
+            case Ctx::Skip:
+                break;
+        }
+        stack.push_back(ctx);
+        return true;
+    }
+
+    bool close() {
+        const Ctx ctx = stack.back();
+        stack.pop_back();
+        switch (ctx) {
+            case Ctx::Meta:    meta_stack.pop_back(); break;
+            case Ctx::Net:     netlist->end_net(); break;
+            case Ctx::Module:  netlist->end_module(); break;
+            case Ctx::Netlist:
+                (netlist_is_new ? current : file.previous) = netlist->finish();
+                netlist.reset();
+                break;
+            default: break;
+        }
+        return true;
+    }
+
+    bool integer(std::int64_t value) {
+        switch (stack.back()) {
+            case Ctx::Net:
+                if      (current_key == "id")   netlist->net.id   = value;
+                else if (current_key == "type") netlist->net.type = value;
+                else if (current_key == "name") unexpected();
+                break;
+            case Ctx::Module:
+                if      (current_key == "id")   netlist->module.id = value;
+                else if (current_key == "name") unexpected();
+                break;
+            case Ctx::NetIds:
+                port->net_ids.push_back(value);
+                break;
+            default:
+                return other(value);
+        }
+        return true;
+    }
+
+    bool text(string_t& value) {
+        switch (stack.back()) {
+            case Ctx::Net:
+                if      (current_key == "name") netlist->net.name.swap(value);
+                else if (current_key == "id" || current_key == "type") unexpected();
+                break;
+            case Ctx::Module:
+                if      (current_key == "name") netlist->module.name.swap(value);
+                else if (current_key == "id") unexpected();
+                break;
+            case Ctx::Params:
+                netlist->module.add_param(current_key).swap(value);
+                break;
+            default:
+                return other(std::move(value));
+        }
+        return true;
+    }
+
+    bool other(nlohmann::json value) {
+        switch (stack.back()) {
+            case Ctx::File:
+                if (current_key == "old" && value.is_null()) break;
+                if (current_key == "new" || current_key == "old") unexpected();
+                [[fallthrough]];
+            case Ctx::Meta:
+                meta_slot(std::move(value));
+                break;
+            case Ctx::Net:
+                if (current_key == "id" || current_key == "name" || current_key == "type") unexpected();
+                break;
+            case Ctx::Module:
+                if (current_key == "id" || current_key == "name") unexpected();
+                break;
+            case Ctx::Nets:
+            case Ctx::Modules:
+            case Ctx::Params:
+            case Ctx::Ports:
+            case Ctx::NetIds:
+                unexpected();
+            default:
+                break;
+        }
+        return true;
+    }
+
+    // Where the next meta value goes: under the current key of the file or
+    // of the enclosing object, or appended to the enclosing array
+    nlohmann::json& meta_slot(nlohmann::json value) {
+        if (meta_stack.empty())
+            return file.meta[current_key] = std::move(value);
+        nlohmann::json& parent = *meta_stack.back();
+        if (parent.is_object())
+            return parent[current_key] = std::move(value);
+        parent.push_back(std::move(value));
+        return parent.back();
+    }
+
+    const std::string&                   path;
+    const Library&                       lib;
+    NetlistFile                          file;
+    std::optional<CompactNetlist>        current;
+    std::optional<NetlistReader>         netlist;
+    bool                                 netlist_is_new{false};
+    NetlistReader::Module::Port*         port{nullptr};
+    std::vector<Ctx>                     stack;
+    std::vector<nlohmann::json*>         meta_stack;
+    std::string                          current_key;
+};
+
+NetlistFile load_json(const std::string& path, const Library& lib) {
+    std::ifstream json_file(path, std::ios::binary);
+    if (!json_file.is_open())
+        throw std::runtime_error("Could not open netlist file: " + path);
+
+    JsonFileReader reader(path, lib);
+    nlohmann::json::sax_parse(json_file, &reader);
+    return reader.take();
+}
+
+}
+
+bool is_snapshot(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(SNAPSHOT_MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    return file && std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+}
+
+NetlistFile NetlistFile::load(const std::string& path, const Library& lib) {
+    return is_snapshot(path) ? load_snapshot(path, lib) : load_json(path, lib);
+}
+
+// Byte for byte what dumping meta plus "new" and "old" with setw(4) gives,
+// but the netlists are streamed rather than built as a DOM first
+void NetlistFile::save_json(const std::string& path) const {
+    std::vector<std::string> keys{"new"};
+    if (previous)
+        keys.emplace_back("old");
+    for (const auto& [key, value] : meta.items())
+        if (key != "new" && key != "old")
+            keys.push_back(key);
+    std::ranges::sort(keys);
+
+    std::ofstream json_file(path, std::ios::trunc);
+    json_file << '{';
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        json_file << (i ? ",\n    " : "\n    ") << nlohmann::json(keys[i]).dump() << ": ";
+        if (keys[i] == "new")
+            current.write_json(json_file, 1);
+        else if (keys[i] == "old")
+            previous->write_json(json_file, 1);
+        else {
+            std::string text = meta[keys[i]].dump(4);
+            for (std::size_t pos = 0; (pos = text.find('\n', pos)) != std::string::npos; pos += 5)
+                text.replace(pos, 1, "\n    ");
+            json_file << text;
+        }
+    }
+    json_file << "\n}" << std::endl;
+}
+
+// Written next to `path` and renamed over it, so a snapshot that is still
+// mapped (the reducer's own input) keeps its old contents
+void NetlistFile::save_snapshot(const std::string& path) const {
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream os(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!os.is_open())
+        throw std::runtime_error("Could not write snapshot: " + tmp_path);
+
+    const std::string meta_text = meta.dump();
+
+    std::vector<std::pair<const char*, const CompactNetlist*>> netlists{{"new", &current}};
+    if (previous)
+        netlists.emplace_back("old", &*previous);
+
+    FileHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version       = SNAPSHOT_VERSION;
+    header.byte_order    = BYTE_ORDER_MARK;
+    header.section_count = static_cast<std::uint32_t>(1 + netlists.size());
+
+    std::vector<SectionEntry> table(header.section_count);
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(SectionEntry)));
+
+    auto section = [&](SectionEntry& entry, const char* name, auto&& write_body) {
+        static constexpr char zeros[8] = {};
+        os.write(zeros, (8 - static_cast<std::streamoff>(os.tellp()) % 8) % 8);
+
+        std::memcpy(entry.name, name, std::strlen(name));
+        entry.offset = static_cast<std::uint64_t>(os.tellp());
+        write_body();
+        entry.size   = static_cast<std::uint64_t>(os.tellp()) - entry.offset;
+    };
+
+    section(table[0], "meta", [&] { os.write(meta_text.data(), static_cast<std::streamsize>(meta_text.size())); });
+    for (std::size_t i = 0; i < netlists.size(); ++i)
+        section(table[i + 1], netlists[i].first, [&] { netlists[i].second->write(os); });
+
+    os.seekp(sizeof(header));
+    os.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(SectionEntry)));
+    os.close();
+    if (!os)
+        throw std::runtime_error("Could not write snapshot: " + tmp_path);
+
+    std::filesystem::rename(tmp_path, path);
+}
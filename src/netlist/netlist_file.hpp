@@ -0,0 +1,32 @@
+#pragma once
+
+#include "compact_netlist.hpp"
+#include "library.hpp"
+
+#include <optional>
+#include <string>
+#include <nlohmann/json.hpp>
+
+// What generate writes and reduce reads back and rewrites: the current
+// ("new") netlist, the last one known to fail ("old") and the reducer's
+// bookkeeping. Stored either as JSON or as a .fzn snapshot.
+//
+// A snapshot is a versioned binary file: a header, a table of named
+// sections, and the sections themselves at 8-byte aligned offsets. "meta"
+// holds the bookkeeping as JSON text; "new" and "old" are CompactNetlist
+// images, which load() maps and uses in place.
+struct NetlistFile {
+    static constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+
+    nlohmann::json                meta = nlohmann::json::object();  // everything but the netlists
+    CompactNetlist                current;
+    std::optional<CompactNetlist> previous;
+
+    // Either format, told apart by content
+    static NetlistFile load(const std::string& path, const Library& lib);
+
+    void save_json    (const std::string& path) const;
+    void save_snapshot(const std::string& path) const;
+};
+
+bool is_snapshot(const std::string& path);
@@ -0,0 +1,337 @@
+#include "reachability.hpp"
+#include "netlist.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+template <typename Visit>
+void for_each_successor(const Net* net, Layer layer, Visit&& visit) {
+    for (const PortBit& sink : net->sinks) {
+        if (layer == Layer::ACYCLIC && sink.port->is_feedback(sink.bit)) continue;
+        const Module* module = sink.port->parent;
+        for (const Port* output : module->outputs) {
+            if (layer == Layer::COMB && module->is_seq_arc(output, sink.port)) continue;
+            for (Net* next : output->nets)
+                if (next) visit(next);
+        }
+    }
+}
+
+template <typename Visit>
+void for_each_predecessor(const Net* net, Layer layer, Visit&& visit) {
+    const Port* driver = net->driver.port;
+    if (!driver) return;
+    const Module* module = driver->parent;
+    for (const Port* input : module->inputs) {
+        if (layer == Layer::COMB && module->is_seq_arc(driver, input)) continue;
+        for (int bit = 0; bit < input->width; ++bit) {
+            if (!input->nets[bit]) continue;
+            if (layer == Layer::ACYCLIC && input->is_feedback(bit)) continue;
+            visit(input->nets[bit]);
+        }
+    }
+}
+
+// Output nets of the port's module that a value on the port reaches in this layer
+template <typename Visit>
+void for_each_reached_output(const Port* port, Layer layer, Visit&& visit) {
+    const Module* module = port->parent;
+    for (const Port* output : module->outputs) {
+        if (layer == Layer::COMB && module->is_seq_arc(output, port)) continue;
+        for (Net* net : output->nets)
+            if (net) visit(net);
+    }
+}
+
+}
+
+void ReachabilityIndex::reset() {
+    acyclic_order.clear();
+    comb_order.clear();
+    seen.clear();
+    stamp      = 0;
+    next_order = 0;
+    is_built   = false;
+}
+
+void ReachabilityIndex::build(const std::vector<Net*>& nets) {
+    reset();
+    is_built = true;
+
+    std::size_t max_id = 0;
+    for (const Net* net : nets)
+        max_id = std::max(max_id, net->id);
+    ensure_size(max_id);
+
+    const int count = static_cast<int>(nets.size());
+
+    // COMB: Kahn's algorithm, the layer must already be acyclic
+    std::vector<int> in_degree(seen.size(), 0);
+    for (const Net* net : nets)
+        for_each_successor(net, Layer::COMB, [&](const Net* next) { ++in_degree[next->id]; });
+
+    std::vector<const Net*> ready;
+    for (const Net* net : nets)
+        if (in_degree[net->id] == 0)
+            ready.push_back(net);
+
+    int position = 0;
+    for (std::size_t i = 0; i < ready.size(); ++i) {
+        comb_order[ready[i]->id] = position++;
+        for_each_successor(ready[i], Layer::COMB, [&](const Net* next) {
+            if (--in_degree[next->id] == 0)
+                ready.push_back(next);
+        });
+    }
+
+    if (position != count)
+        throw std::runtime_error("Netlist contains a combinational loop");
+
+    // ACYCLIC: depth-first search in reverse postorder, input bits that close
+    // a back edge are marked as feedback
+    struct Arc   { const Net* next; Port* port; int bit; };
+    struct Frame { const Net* net; std::vector<Arc> arcs; std::size_t next{0}; };
+
+    auto arcs_of = [](const Net* net) {
+        std::vector<Arc> arcs;
+        for (const PortBit& sink : net->sinks) {
+            if (sink.port->is_feedback(sink.bit)) continue;
+            for (const Port* output : sink.port->parent->outputs)
+                for (Net* next : output->nets)
+                    if (next) arcs.push_back(Arc{next, sink.port, sink.bit});
+        }
+        return arcs;
+    };
+
+    enum : char { UNVISITED, ACTIVE, DONE };
+    std::vector<char> state(seen.size(), UNVISITED);
+    int remaining = count;
+
+    for (const Net* root : nets) {
+        if (state[root->id] != UNVISITED) continue;
+
+        std::vector<Frame> stack;
+        stack.push_back(Frame{root, arcs_of(root)});
+        state[root->id] = ACTIVE;
+
+        while (!stack.empty()) {
+            Frame& top = stack.back();
+            if (top.next == top.arcs.size()) {
+                state[top.net->id]         = DONE;
+                acyclic_order[top.net->id] = --remaining;
+                stack.pop_back();
+                continue;
+            }
+
+            const Arc arc = top.arcs[top.next++];
+            if (arc.port->is_feedback(arc.bit)) continue;
+
+            if (state[arc.next->id] == ACTIVE) {
+                arc.port->mark_feedback(arc.bit);
+            } else if (state[arc.next->id] == UNVISITED) {
+                state[arc.next->id] = ACTIVE;
+                stack.push_back(Frame{arc.next, arcs_of(arc.next)});
+            }
+        }
+    }
+
+    next_order = count;
+}
+
+void ReachabilityIndex::add_net(const Net* net) {
+    if (!is_built) return;
+    ensure_size(net->id);
+    acyclic_order[net->id] = next_order;
+    comb_order[net->id]    = next_order;
+    ++next_order;
+}
+
+void ReachabilityIndex::add_pin(Port* port, int bit) {
+    if (!is_built) return;
+    for (const Port* output : port->parent->outputs)
+        for (int i = 0; i < output->width; ++i)
+            insert_arc(port, bit, output, i);
+}
+
+void ReachabilityIndex::add_driver(const Net* net) {
+    if (!is_built || !net->driver.port) return;
+    for (Port* input : net->driver.port->parent->inputs)
+        for (int i = 0; i < input->width; ++i)
+            insert_arc(input, i, net->driver.port, net->driver.bit);
+}
+
+void ReachabilityIndex::insert_arc(Port* input, int bit, const Port* output, int output_bit) {
+    const Net* source = input->nets[bit];
+    const Net* target = output->nets[output_bit];
+    if (!source || !target) return;
+
+    if (!input->parent->is_seq_arc(output, input) && !insert_edge(source, target, Layer::COMB))
+        throw std::runtime_error("Connection closes a combinational loop");
+
+    if (!input->is_feedback(bit) && !insert_edge(source, target, Layer::ACYCLIC))
+        input->mark_feedback(bit);
+}
+
+// Pearce-Kelly: if the new edge violates the order, collect the nets reachable
+// from `to` and the nets reaching `from` inside the affected window, then hand
+// the window's order slots back out with all of the latter before the former.
+bool ReachabilityIndex::insert_edge(const Net* from, const Net* to, Layer layer) {
+    std::vector<int>& ord = order(layer);
+    const int lower = ord[to->id];
+    const int upper = ord[from->id];
+
+    if (lower > upper) return true;
+    if (from == to)    return false;
+
+    next_stamp();
+
+    std::vector<const Net*> forward{to};
+    seen[to->id] = stamp;
+    bool cycle   = false;
+    for (std::size_t i = 0; i < forward.size() && !cycle; ++i)
+        for_each_successor(forward[i], layer, [&](const Net* next) {
+            if (next == from) {
+                cycle = true;
+            } else if (ord[next->id] < upper && seen[next->id] != stamp) {
+                seen[next->id] = stamp;
+                forward.push_back(next);
+            }
+        });
+
+    if (cycle) return false;
+
+    std::vector<const Net*> backward{from};
+    seen[from->id] = stamp;
+    for (std::size_t i = 0; i < backward.size(); ++i)
+        for_each_predecessor(backward[i], layer, [&](const Net* prev) {
+            if (ord[prev->id] > lower && seen[prev->id] != stamp) {
+                seen[prev->id] = stamp;
+                backward.push_back(prev);
+            }
+        });
+
+    auto by_order = [&](const Net* a, const Net* b) { return ord[a->id] < ord[b->id]; };
+    std::sort(forward.begin(),  forward.end(),  by_order);
+    std::sort(backward.begin(), backward.end(), by_order);
+
+    std::vector<int> slots;
+    slots.reserve(forward.size() + backward.size());
+    for (const Net* net : backward) slots.push_back(ord[net->id]);
+    for (const Net* net : forward)  slots.push_back(ord[net->id]);
+    std::sort(slots.begin(), slots.end());
+
+    std::size_t slot = 0;
+    for (const Net* net : backward) ord[net->id] = slots[slot++];
+    for (const Net* net : forward)  ord[net->id] = slots[slot++];
+
+    return true;
+}
+
+// Would driving `port` from `source` close a loop in `layer`? A negative
+// budget searches exhaustively, otherwise UNKNOWN once `budget` nets have
+// been expanded without an answer.
+Reach ReachabilityIndex::closes_loop(const Net* source, const Port* port, Layer layer, int budget) {
+    const std::vector<int>* ord = (layer == Layer::FULL) ? nullptr : &order(layer);
+
+    auto may_reach_source = [&](const Net* net) {
+        return !ord || (*ord)[net->id] < (*ord)[source->id];
+    };
+
+    next_stamp();
+
+    std::vector<const Net*> work;
+    bool found = false;
+    for_each_reached_output(port, layer, [&](const Net* net) {
+        if (net == source) {
+            found = true;
+        } else if (may_reach_source(net) && seen[net->id] != stamp) {
+            seen[net->id] = stamp;
+            work.push_back(net);
+        }
+    });
+
+    for (std::size_t i = 0; i < work.size() && !found; ++i) {
+        if (budget >= 0 && static_cast<int>(i) >= budget)
+            return Reach::UNKNOWN;
+
+        for_each_successor(work[i], layer, [&](const Net* next) {
+            if (next == source) {
+                found = true;
+            } else if (may_reach_source(next) && seen[next->id] != stamp) {
+                seen[next->id] = stamp;
+                work.push_back(next);
+            }
+        });
+    }
+
+    return found ? Reach::YES : Reach::NO;
+}
+
+// Every net that would close a loop in the ACYCLIC or COMB layer if it drove `port`
+std::vector<Net*> ReachabilityIndex::loop_cone(const Port* port) {
+    std::vector<Net*> comb;
+    std::vector<Net*> cone;
+
+    next_stamp();
+    traverse(port, Layer::COMB, comb);
+    next_stamp();
+    traverse(port, Layer::ACYCLIC, cone);
+
+    for (Net* net : comb)
+        if (seen[net->id] != stamp) {
+            seen[net->id] = stamp;
+            cone.push_back(net);
+        }
+    return cone;
+}
+
+// Nets downstream of `port` only through a sequential arc: driving the port
+// from one of them closes a loop that is not combinational
+std::vector<Net*> ReachabilityIndex::sequential_cone(const Port* port) {
+    std::vector<Net*> full;
+    std::vector<Net*> comb;
+
+    next_stamp();
+    traverse(port, Layer::FULL, full);
+    next_stamp();
+    traverse(port, Layer::COMB, comb);
+
+    std::erase_if(full, [&](const Net* net) { return seen[net->id] == stamp; });
+    return full;
+}
+
+void ReachabilityIndex::traverse(const Port* port, Layer layer, std::vector<Net*>& visited) {
+    const std::size_t first = visited.size();
+
+    for_each_reached_output(port, layer, [&](Net* net) {
+        if (seen[net->id] != stamp) {
+            seen[net->id] = stamp;
+            visited.push_back(net);
+        }
+    });
+
+    for (std::size_t i = first; i < visited.size(); ++i)
+        for_each_successor(visited[i], layer, [&](Net* next) {
+            if (seen[next->id] != stamp) {
+                seen[next->id] = stamp;
+                visited.push_back(next);
+            }
+        });
+}
+
+void ReachabilityIndex::ensure_size(std::size_t id) {
+    if (id < seen.size()) return;
+    const std::size_t size = std::max(id + 1, seen.size() * 2);
+    acyclic_order.resize(size, 0);
+    comb_order.resize(size, 0);
+    seen.resize(size, 0);
+}
+
+void ReachabilityIndex::next_stamp() {
+    if (++stamp == 0) {
+        std::fill(seen.begin(), seen.end(), 0);
+        stamp = 1;
+    }
+}
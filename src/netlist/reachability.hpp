@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct Net;
+struct Port;
+
+// Graph layers over nets, an edge a -> b meaning net a feeds an input of the
+// module driving net b.
+//   FULL     every edge
+//   ACYCLIC  every edge except input bits marked as feedback (Port::feedback),
+//            the deliberate sequential loops
+//   COMB     edges through combinational input -> output arcs only
+enum class Layer { FULL, ACYCLIC, COMB };
+enum class Reach { NO, YES, UNKNOWN };
+
+// Incrementally maintained topological orders of the ACYCLIC and COMB layers
+// (Pearce-Kelly dynamic topological ordering). "Would connecting this net to
+// this port close a loop?" is then an order comparison in the common case
+// and a small bounded search otherwise. Removing nets or edges never breaks
+// a topological order, so removals need no bookkeeping.
+class ReachabilityIndex {
+public:
+    bool built() const { return is_built; }
+    void reset();
+    void build(const std::vector<Net*>& nets);
+
+    void add_net   (const Net* net);
+    void add_pin   (Port* port, int bit);
+    void add_driver(const Net* net);
+
+    Reach            closes_loop    (const Net* source, const Port* port, Layer layer, int budget = -1);
+    std::vector<Net*> loop_cone      (const Port* port);
+    std::vector<Net*> sequential_cone(const Port* port);
+
+private:
+    std::vector<int>& order(Layer layer) { return layer == Layer::COMB ? comb_order : acyclic_order; }
+
+    bool insert_edge(const Net* from, const Net* to, Layer layer);
+    void insert_arc (Port* input, int bit, const Port* output, int output_bit);
+    void traverse   (const Port* port, Layer layer, std::vector<Net*>& visited);
+    void ensure_size(std::size_t id);
+    void next_stamp ();
+
+    std::vector<int>           acyclic_order;
+    std::vector<int>           comb_order;
+    std::vector<std::uint32_t> seen;
+    std::uint32_t              stamp{0};
+    int                        next_order{0};
+    bool                       is_built{true};
+};
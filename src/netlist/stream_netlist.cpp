@@ -0,0 +1,361 @@
+#include "stream_netlist.hpp"
+#include "packed_param.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Every id in a spill file of raw std::uint32_t, in order
+template <typename Fn>
+void for_each_id(const std::string& path, Fn fn) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        throw std::runtime_error("Could not read: " + path);
+
+    std::vector<std::uint32_t> chunk(1 << 16);
+    while (in) {
+        in.read(reinterpret_cast<char*>(chunk.data()),
+                static_cast<std::streamsize>(chunk.size() * sizeof(std::uint32_t)));
+        const auto n = static_cast<std::size_t>(in.gcount()) / sizeof(std::uint32_t);
+        for (std::size_t i = 0; i < n; ++i) fn(chunk[i]);
+    }
+}
+
+void write_id(std::ofstream& file, std::uint32_t id) {
+    file.write(reinterpret_cast<const char*>(&id), sizeof(id));
+}
+
+}
+
+StreamNetlist::StreamNetlist(const Library&     lib,
+                             std::mt19937_64&   rng,
+                             const std::string& verilog_path,
+                             std::size_t        frontier,
+                             double             seq_mod_prob,
+                             double             seq_port_prob)
+    : lib{lib},
+      rng{rng},
+      verilog_path(verilog_path),
+      frontier_size(frontier),
+      seq_mod_prob(seq_mod_prob),
+      seq_port_prob(seq_port_prob) {
+    if (frontier_size == 0)
+        throw std::runtime_error("Frontier must hold at least one net");
+
+    body_file  .open(verilog_path + ".body", std::ios::binary | std::ios::trunc);
+    input_file .open(verilog_path + ".in",   std::ios::binary | std::ios::trunc);
+    output_file.open(verilog_path + ".out",  std::ios::binary | std::ios::trunc);
+    if (!body_file.is_open() || !input_file.is_open() || !output_file.is_open()) {
+        remove_spill_files();
+        throw std::runtime_error("Could not write: " + verilog_path);
+    }
+    body = std::make_unique<OutputBuffer>(body_file);
+}
+
+StreamNetlist::~StreamNetlist() {
+    if (finished) return;
+    body.reset();
+    body_file.close();
+    input_file.close();
+    output_file.close();
+    remove_spill_files();
+}
+
+void StreamNetlist::add_initial_nets() {
+    const std::uint32_t input_net = make_net(NetType::EXT_IN);
+    const std::uint32_t clock_net = make_net(NetType::EXT_CLK, "clk");
+    add_to_frontier(NetType::EXT_IN,  input_net, 1);
+    add_to_frontier(NetType::EXT_CLK, clock_net, 1);
+
+    add_buffer(input_net, lib.get_random_buffer(rng, NetType::EXT_IN,  NetType::LOGIC));
+    add_buffer(clock_net, lib.get_random_buffer(rng, NetType::EXT_CLK, NetType::CLK));
+}
+
+void StreamNetlist::add_random_module() {
+    add_module(lib.get_random_module(rng));
+}
+
+void StreamNetlist::add_external_nets(std::size_t number) {
+    for (std::size_t i = 0; i < number; ++i) {
+        const std::uint32_t ext_net = make_net(NetType::EXT_IN);
+        add_to_frontier(NetType::EXT_IN, ext_net, 1);
+        add_buffer(ext_net, lib.get_random_buffer(rng, NetType::EXT_IN, NetType::LOGIC));
+    }
+}
+
+void StreamNetlist::add_undriven_nets(std::size_t number) {
+    for (std::size_t i = 0; i < number; ++i) {
+        if (undriven.size() >= frontier_size)
+            drive_undriven_nets(true);
+        undriven.push_back({make_net(NetType::LOGIC), 0});
+    }
+}
+
+void StreamNetlist::drive_undriven_nets(bool limit_to_one) {
+    while (!undriven.empty()) {
+        const FrontierNet net = undriven.front();
+        undriven.pop_front();
+        drive(net.id);
+        add_to_frontier(NetType::LOGIC, net.id, net.sinks);
+        if (limit_to_one) break;
+    }
+}
+
+void StreamNetlist::buffer_unconnected_outputs() {
+    // The buffers' outputs are top outputs, which never enter a frontier
+    for (FrontierNet& net : frontiers[static_cast<std::size_t>(NetType::LOGIC)].nets)
+        if (net.sinks == 0) {
+            net.sinks = 1;
+            add_buffer(net.id, lib.get_random_buffer(rng, NetType::LOGIC, NetType::EXT_OUT));
+        }
+}
+
+void StreamNetlist::finish(const std::string& top_name) {
+    drive_undriven_nets();
+    buffer_unconnected_outputs();
+
+    body.reset();
+    body_file.close();
+    input_file.close();
+    output_file.close();
+    if (!body_file || !input_file || !output_file)
+        throw std::runtime_error("Could not write: " + verilog_path);
+
+    std::ofstream v(verilog_path, std::ios::binary | std::ios::trunc);
+    if (!v.is_open())
+        throw std::runtime_error("Could not write: " + verilog_path);
+
+    {
+        OutputBuffer out(v);
+        bool         first = true;
+        auto list_port = [&](std::uint32_t net) {
+            if (!first) out.put(", ");
+            put_label(out, net);
+            first = false;
+        };
+
+        out.put("module ");
+        out.put(top_name);
+        out.put('(');
+        for_each_id(verilog_path + ".in", list_port);
+        if (stats.output_nets > 0) out.put(", ");
+        first = true;
+        for_each_id(verilog_path + ".out", list_port);
+        out.put(");\n");
+
+        for_each_id(verilog_path + ".in", [&](std::uint32_t net) {
+            out.put("  input  ");
+            put_label(out, net);
+            out.put(";\n");
+        });
+        for_each_id(verilog_path + ".out", [&](std::uint32_t net) {
+            out.put("  output ");
+            put_label(out, net);
+            out.put(";\n");
+        });
+    }
+
+    std::ifstream body_in(verilog_path + ".body", std::ios::binary);
+    if (body_in.peek() != std::ifstream::traits_type::eof())
+        v << body_in.rdbuf();
+    v << "endmodule\n";
+    body_in.close();
+
+    if (!v)
+        throw std::runtime_error("Could not write: " + verilog_path);
+
+    remove_spill_files();
+    finished = true;
+}
+
+std::uint32_t StreamNetlist::next_id() {
+    if (id_counter == std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error("Out of net and module ids");
+    return id_counter++;
+}
+
+std::uint32_t StreamNetlist::make_net(NetType type, const char* name) {
+    const std::uint32_t id = next_id();
+    ++stats.total_nets;
+
+    switch (type) {
+        case NetType::EXT_CLK:
+            if (name) clock_id = id;
+            write_id(input_file, id);
+            break;
+        case NetType::EXT_IN:
+            ++stats.input_nets;
+            write_id(input_file, id);
+            break;
+        case NetType::EXT_OUT:
+            ++stats.output_nets;
+            write_id(output_file, id);
+            break;
+        case NetType::LOGIC:
+            body->put("  wire   ");
+            put_label(*body, id);
+            body->put(";\n");
+            break;
+        case NetType::CLK:
+            break;
+    }
+    return id;
+}
+
+// A full frontier forgets its oldest net, which is buffered out if nothing
+// reads it
+void StreamNetlist::add_to_frontier(NetType type, std::uint32_t id, std::uint32_t sinks) {
+    if (type == NetType::EXT_OUT) return;
+
+    Frontier& frontier = frontiers[static_cast<std::size_t>(type)];
+    if (frontier.nets.size() < frontier_size) {
+        frontier.nets.push_back({id, sinks});
+        return;
+    }
+
+    const FrontierNet evicted = frontier.nets[frontier.oldest];
+    frontier.nets[frontier.oldest] = {id, sinks};
+    frontier.oldest = (frontier.oldest + 1) % frontier_size;
+
+    if (type == NetType::LOGIC && evicted.sinks == 0)
+        add_buffer(evicted.id, lib.get_random_buffer(rng, NetType::LOGIC, NetType::EXT_OUT));
+}
+
+std::uint32_t StreamNetlist::pick_source(const ModuleSpec& spec, const PortSpec& port) {
+    if (port.net_type == NetType::LOGIC && !undriven.empty()) {
+        bool seq_arc = true;
+        for (std::size_t output = 0; output < spec.outputs.size(); ++output)
+            seq_arc = seq_arc && spec.is_seq_arc(static_cast<int>(output), port.index);
+
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        if (seq_arc && dist(rng) < seq_port_prob) {
+            std::uniform_int_distribution<std::size_t> pick(0, undriven.size() - 1);
+            FrontierNet& net = undriven[pick(rng)];
+            ++net.sinks;
+            return net.id;
+        }
+    }
+
+    std::vector<FrontierNet>& pool = frontiers[static_cast<std::size_t>(port.net_type)].nets;
+    if (pool.empty())
+        throw std::runtime_error("No nets of requested type");
+
+    std::uniform_int_distribution<std::size_t> pick(0, pool.size() - 1);
+    FrontierNet& net = pool[pick(rng)];
+    ++net.sinks;
+    return net.id;
+}
+
+void StreamNetlist::add_buffer(std::uint32_t net, const ModuleSpec& buffer_spec) {
+    if (buffer_spec.input_bits != 1 || buffer_spec.output_bits != 1)
+        throw std::runtime_error("Module is not a buffer");
+
+    const std::uint32_t id      = next_id();
+    randomize_params(buffer_spec);
+    const NetType       type    = buffer_spec.outputs[0].net_type;
+    const std::uint32_t out_net = make_net(type);
+
+    const std::uint32_t buffer_pins[] = {net, out_net};
+    emit_module(buffer_spec, id, buffer_pins);
+    add_to_frontier(type, out_net, 0);
+}
+
+// Inputs come from the frontiers. With `driven` set, the module is that
+// net's driver and has a single output bit for it; otherwise each output
+// bit drives a new net, added to the frontiers once the module is written.
+void StreamNetlist::add_module(const ModuleSpec& spec, std::uint32_t driven) {
+    const std::uint32_t id = next_id();
+    randomize_params(spec);
+
+    pins.assign(static_cast<std::size_t>(spec.input_bits + spec.output_bits), 0);
+    for (const PortSpec& port : spec.inputs)
+        for (int i = 0; i < port.width; ++i)
+            pins[port.offset + i] = pick_source(spec, port);
+
+    // New output nets take consecutive ids, nothing else is made meanwhile
+    const std::uint32_t first_output = id_counter;
+    if (driven) {
+        pins[spec.input_bits] = driven;
+    } else {
+        for (const PortSpec& port : spec.outputs)
+            for (int i = 0; i < port.width; ++i)
+                pins[port.offset + i] = make_net(port.net_type);
+    }
+
+    emit_module(spec, id, pins);
+    if (driven) return;
+
+    std::uint32_t net = first_output;
+    for (const PortSpec& port : spec.outputs)
+        for (int i = 0; i < port.width; ++i)
+            add_to_frontier(port.net_type, net++, 0);
+}
+
+void StreamNetlist::drive(std::uint32_t net) {
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    const bool seq_mod = dist(rng) < seq_mod_prob;
+
+    const ModuleSpec& driver_spec = lib.get_random_driver(rng, NetType::LOGIC, 1, seq_mod);
+    if (driver_spec.output_bits != 1)
+        throw std::runtime_error("Driver has more than one output bit: " + driver_spec.name);
+    add_module(driver_spec, net);
+}
+
+void StreamNetlist::randomize_params(const ModuleSpec& spec) {
+    param_words.assign(static_cast<std::size_t>(spec.param_words), 0);
+    for (const ParamSpec& param : spec.params)
+        packed::randomize(std::span(param_words).subspan(param.offset, packed::word_count(param.width)),
+                          param.width, rng);
+}
+
+void StreamNetlist::emit_module(const ModuleSpec& spec, std::uint32_t id, std::span<const std::uint32_t> module_pins) {
+    const VerilogKindText& text = kind_text.try_emplace(&spec, spec).first->second;
+    OutputBuffer&          out  = *body;
+
+    out.put(text.head);
+    for (std::size_t i = 0; i < spec.params.size(); ++i) {
+        const ParamSpec& param = spec.params[i];
+        out.put_binary(std::span<const std::uint64_t>(param_words).subspan(param.offset, packed::word_count(param.width)),
+                       param.width);
+        out.put(text.param_text[i]);
+    }
+
+    out.put_padded_id(id, ID_WIDTH);
+    out.put(" (\n");
+
+    std::size_t pin        = 0;
+    std::size_t port_index = 0;
+    for (const auto* ports : {&spec.inputs, &spec.outputs})
+        for (const auto& port : *ports) {
+            out.put(text.port_text[port_index]);
+            for (int j = 0; j < port.width; ++j, ++pin) {
+                if (module_pins[pin]) put_label(out, module_pins[pin]);
+                else                  out.put("1'b0");
+                if (j + 1 < port.width) out.put(", ");
+            }
+            out.put(text.port_close[port_index++]);
+        }
+    out.put("  );\n");
+
+    for (const auto& [name, count] : spec.resource)
+        stats.resources[name] += count;
+
+    ++stats.total_modules;
+    ++stats.primitives[spec.name];
+    if (spec.combinational) ++stats.comb_modules;
+    else                    ++stats.seq_modules;
+}
+
+void StreamNetlist::put_label(OutputBuffer& out, std::uint32_t net) const {
+    if (net == clock_id) out.put(std::string_view("clk"));
+    else                 out.put_padded_id(net, ID_WIDTH);
+}
+
+void StreamNetlist::remove_spill_files() {
+    std::error_code ignored;
+    for (const char* suffix : {".body", ".in", ".out"})
+        std::filesystem::remove(verilog_path + suffix, ignored);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "library.hpp"
+#include "module.hpp"
+#include "netlist.hpp"
+#include "verilog_text.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Generates like Netlist, but writes every module instance to the Verilog
+// as soon as its pins are fixed and forgets it. Only a frontier of recent
+// nets, of at most `frontier` per net type, stays in memory to be picked as
+// inputs, so memory does not grow with the design.
+//
+// A net leaving the frontier without sinks is buffered to a new top output
+// there and then. Undriven nets may only feed inputs that are sequential
+// arcs to all of their module's outputs, so driving them later cannot close
+// a combinational loop.
+//
+// Instances go to <verilog_path>.body and the top ports to .in and .out
+// beside it; finish() joins them into <verilog_path>.
+class StreamNetlist {
+public:
+    StreamNetlist(const Library&     lib,
+                  std::mt19937_64&   rng,
+                  const std::string& verilog_path,
+                  std::size_t        frontier,
+                  double             seq_mod_prob,
+                  double             seq_port_prob);
+    ~StreamNetlist();
+    StreamNetlist(const StreamNetlist&)            = delete;
+    StreamNetlist& operator=(const StreamNetlist&) = delete;
+
+    void add_initial_nets();
+    void add_random_module();
+    void add_external_nets(std::size_t number = 1);
+    void add_undriven_nets(std::size_t number = 1);
+    void drive_undriven_nets(bool limit_to_one = false);
+    void buffer_unconnected_outputs();
+
+    // Drives what is left undriven, buffers every sink-less net and writes
+    // the Verilog
+    void finish(const std::string& top_name = "top");
+
+    const NetlistStats& get_stats() const { return stats; }
+
+private:
+    // Every net is named by its zero-padded id, at a width fixed up front as
+    // the final id is not known until the end
+    static constexpr int ID_WIDTH = 10;
+
+    struct FrontierNet {
+        std::uint32_t id;
+        std::uint32_t sinks;
+    };
+
+    // The newest nets of one type, oldest overwritten first
+    struct Frontier {
+        std::vector<FrontierNet> nets;
+        std::size_t              oldest{0};
+    };
+
+    std::uint32_t next_id();
+    std::uint32_t make_net(NetType type, const char* name = nullptr);
+    void          add_to_frontier(NetType type, std::uint32_t id, std::uint32_t sinks);
+    std::uint32_t pick_source(const ModuleSpec& spec, const PortSpec& port);
+    void          add_buffer(std::uint32_t net, const ModuleSpec& buffer_spec);
+    void          add_module(const ModuleSpec& spec, std::uint32_t driven = 0);
+    void          drive(std::uint32_t net);
+    void          randomize_params(const ModuleSpec& spec);
+    void          emit_module(const ModuleSpec& spec, std::uint32_t id, std::span<const std::uint32_t> module_pins);
+    void          put_label(OutputBuffer& out, std::uint32_t net) const;
+    void          remove_spill_files();
+
+    const Library&     lib;
+    std::mt19937_64&   rng;
+    std::string        verilog_path;
+    std::size_t        frontier_size;
+    double             seq_mod_prob;
+    double             seq_port_prob;
+
+    std::ofstream                 body_file;
+    std::ofstream                 input_file;   // ids of top inputs, in order
+    std::ofstream                 output_file;  // ids of top outputs
+    std::unique_ptr<OutputBuffer> body;
+
+    std::array<Frontier, NET_TYPE_COUNT> frontiers;
+    std::deque<FrontierNet>              undriven;   // oldest first
+
+    std::uint32_t id_counter{1};
+    std::uint32_t clock_id{0};   // the one named net, "clk"
+    bool          finished{false};
+    NetlistStats  stats;
+
+    // Scratch for the module being placed: its pin nets, inputs then
+    // outputs (0 for none), and packed parameters
+    std::vector<std::uint32_t> pins;
+    std::vector<std::uint64_t> param_words;
+
+    std::unordered_map<const ModuleSpec*, VerilogKindText> kind_text;
+};
@@ -0,0 +1,160 @@
+#include "struct_check.hpp"
+#include "packed_param.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+namespace {
+
+using Index = CompactNetlist::Index;
+
+// Cells that pass their single input through unchanged
+const std::set<std::string, std::less<>> BUFFERS = {"BUF", "BUFG", "BUFH", "IBUF", "IBUFG", "OBUF"};
+
+// Nodes 0..2 are shared by both sides, then each side's nets follow
+enum : std::uint32_t { CONST0, CONST1, OPEN, FIRST_NET };
+
+struct Side {
+    const FuncsimNetlist&      netlist;
+    std::uint32_t              first_node;
+    std::vector<Index>         source;    // net after looking through buffers, NONE if constant or open
+    std::vector<std::uint32_t> constant;  // CONST0, CONST1 or OPEN where source is NONE
+};
+
+bool is_buffer(const CompactNetlist& netlist, Index module) {
+    const ModuleSpec& spec = netlist.module_spec(module);
+    if (BUFFERS.contains(spec.name))
+        return true;
+    // LUT1 with INIT 2'b10 is O = I0
+    return spec.name == "LUT1" && !spec.params.empty() && netlist.param(module, 0)[0] == 0b10;
+}
+
+// Where each net's value comes from once buffers are removed. A buffer loop
+// stays where it is.
+void resolve(Side& side) {
+    const CompactNetlist& netlist = side.netlist.netlist;
+    const Index           count   = static_cast<Index>(netlist.net_count());
+    side.source.assign(count, CompactNetlist::NONE);
+    side.constant.assign(count, OPEN);
+
+    for (Index net = 0; net < count; ++net) {
+        Index current = net;
+        for (Index steps = 0; steps <= count; ++steps) {
+            const Index pin = netlist.driver(current);
+            if (pin == CompactNetlist::NONE) {
+                if      (netlist.net_name(current) == "<const0>") side.constant[net] = CONST0;
+                else if (netlist.net_name(current) == "<const1>") side.constant[net] = CONST1;
+                break;
+            }
+            const Index        module = netlist.pin_module(pin);
+            const std::string& kind   = netlist.module_spec(module).name;
+            if (kind == "GND") { side.constant[net] = CONST0; break; }
+            if (kind == "VCC") { side.constant[net] = CONST1; break; }
+            if (!is_buffer(netlist, module)) break;
+
+            const Index input = netlist.pin_net(netlist.first_pin(module));
+            if (input == CompactNetlist::NONE) { side.constant[net] = OPEN; current = CompactNetlist::NONE; break; }
+            current = input;
+        }
+        if (side.constant[net] == OPEN && current != CompactNetlist::NONE)
+            side.source[net] = current;
+    }
+}
+
+std::uint32_t node(const Side& side, Index net) {
+    if (net == CompactNetlist::NONE) return OPEN;
+    return side.source[net] == CompactNetlist::NONE ? side.constant[net] : side.first_node + side.source[net];
+}
+
+struct VectorHash {
+    std::size_t operator()(const std::vector<std::uint32_t>& v) const {
+        std::size_t h = v.size();
+        for (std::uint32_t x : v) h ^= x + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        return h;
+    }
+};
+
+}
+
+StructCheck StructCheck::run(const FuncsimNetlist& gold, const FuncsimNetlist& gate) {
+    Side sides[2] = {{gold, FIRST_NET, {}, {}},
+                     {gate, FIRST_NET + static_cast<std::uint32_t>(gold.netlist.net_count()), {}, {}}};
+    const std::uint32_t node_count = sides[1].first_node + static_cast<std::uint32_t>(gate.netlist.net_count());
+
+    // Initial classes: constants, inputs by port name, a cell kind with its
+    // parameters and output pin, or a class of its own for a floating net
+    std::map<std::string, std::uint32_t> keys;
+    auto key_class = [&](std::string key) { return keys.try_emplace(std::move(key), static_cast<std::uint32_t>(keys.size())).first->second; };
+
+    std::vector<std::uint32_t>              klass(node_count);
+    std::vector<std::vector<std::uint32_t>> inputs(node_count);
+    klass[CONST0] = key_class("const0");
+    klass[CONST1] = key_class("const1");
+    klass[OPEN]   = key_class("open");
+
+    for (Side& side : sides) {
+        resolve(side);
+        const CompactNetlist& netlist = side.netlist.netlist;
+
+        std::vector<std::string> port_of(netlist.net_count());
+        for (const auto& port : side.netlist.inputs)
+            if (port_of[port.net].empty() || port.name < port_of[port.net])
+                port_of[port.net] = port.name;
+
+        for (Index net = 0; net < netlist.net_count(); ++net) {
+            const std::uint32_t n   = side.first_node + net;
+            const Index         pin = netlist.driver(net);
+            if (pin == CompactNetlist::NONE) {
+                klass[n] = key_class(port_of[net].empty() ? "floating " + std::to_string(n) : "input " + port_of[net]);
+                continue;
+            }
+
+            const Index       module = netlist.pin_module(pin);
+            const ModuleSpec& spec   = netlist.module_spec(module);
+            std::string key = "cell " + spec.name + " " + std::to_string(pin - netlist.first_pin(module));
+            for (std::size_t i = 0; i < spec.params.size(); ++i)
+                key += " " + packed::to_hex(netlist.param(module, i), spec.params[i].width);
+            key += " " + side.netlist.extra_params[module];
+            klass[n] = key_class(std::move(key));
+
+            for (int i = 0; i < spec.input_bits; ++i)
+                inputs[n].push_back(node(side, netlist.pin_net(netlist.first_pin(module) + i)));
+        }
+    }
+
+    // Refine until no class splits
+    std::size_t class_count = keys.size();
+    std::vector<std::uint32_t> next(node_count);
+    std::vector<std::uint32_t> signature;
+    while (true) {
+        std::unordered_map<std::vector<std::uint32_t>, std::uint32_t, VectorHash> ids;
+        for (std::uint32_t n = 0; n < node_count; ++n) {
+            signature.assign(1, klass[n]);
+            for (std::uint32_t input : inputs[n])
+                signature.push_back(klass[input]);
+            next[n] = ids.try_emplace(signature, static_cast<std::uint32_t>(ids.size())).first->second;
+        }
+        klass.swap(next);
+        if (ids.size() == class_count) break;
+        class_count = ids.size();
+    }
+
+    StructCheck result;
+    std::map<std::string, std::uint32_t> gold_outputs, gate_outputs;
+    for (const auto& port : gold.outputs) gold_outputs[port.name] = node(sides[0], port.net);
+    for (const auto& port : gate.outputs) gate_outputs[port.name] = node(sides[1], port.net);
+
+    for (const auto& [name, n] : gold_outputs) {
+        auto it = gate_outputs.find(name);
+        if (it == gate_outputs.end() || klass[n] != klass[it->second])
+            result.unmatched.push_back(name);
+    }
+    for (const auto& [name, n] : gate_outputs)
+        if (!gold_outputs.contains(name))
+            result.unmatched.push_back(name);
+
+    result.match = result.unmatched.empty();
+    return result;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "funcsim_reader.hpp"
+
+#include <string>
+#include <vector>
+
+// Structural match of two flat netlists, standing in for Yosys' equiv_struct
+// on the common case. Buffers are looked through and GND/VCC outputs become
+// constants. Nets are then partitioned by (cell, parameters, output pin,
+// classes of the cell's inputs) until the partition is stable, starting from
+// input ports matched by name. Two outputs in the same class compute the same
+// function. Outputs in different classes are only structurally different;
+// they may still be equivalent.
+struct StructCheck {
+    bool                     match{false};
+    std::vector<std::string> unmatched;  // output port bits not shown equal
+
+    static StructCheck run(const FuncsimNetlist& gold, const FuncsimNetlist& gate);
+};
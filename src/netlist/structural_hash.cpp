@@ -0,0 +1,139 @@
+#include "structural_hash.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Index = CompactNetlist::Index;
+
+constexpr std::uint64_t UNDRIVEN_SEED = 0x756e64726976656eULL;
+constexpr std::uint64_t OPEN_PIN      = 0x6f70656e2d70696eULL;
+constexpr std::uint64_t OUTPUTS_SEED  = 0x6f75747075747321ULL;
+
+std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+std::uint64_t combine(std::uint64_t seed, std::uint64_t value) {
+    return mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+// FNV-1a, so a fingerprint stays the same across builds and machines
+std::uint64_t hash_text(std::string_view text) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : text) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+std::size_t count_distinct(std::vector<std::uint64_t> labels) {
+    std::sort(labels.begin(), labels.end());
+    return static_cast<std::size_t>(std::unique(labels.begin(), labels.end()) - labels.begin());
+}
+
+}
+
+std::uint64_t structural_hash(const CompactNetlist& netlist) {
+    const auto nets    = static_cast<Index>(netlist.net_count());
+    const auto modules = static_cast<Index>(netlist.module_count());
+
+    // The net each net is a buffered copy of, itself if none, and the kinds
+    // of the buffers in between
+    std::vector<Index>         source(nets);
+    std::vector<std::uint64_t> through(nets);
+    for (Index n = 0; n < nets; ++n) {
+        Index         at      = n;
+        std::uint64_t buffers = 0;
+        for (Index hops = 0; hops < nets; ++hops) {
+            const Index pin = netlist.driver(at);
+            if (pin == CompactNetlist::NONE) break;
+            const Index       module = netlist.pin_module(pin);
+            const Index       input  = netlist.pin_net(netlist.first_pin(module));
+            const ModuleSpec& spec   = netlist.module_spec(module);
+            if (!spec.is_buffer() || input == CompactNetlist::NONE) break;
+            buffers = combine(buffers, hash_text(spec.name));
+            at      = input;
+        }
+        source[n]  = at;
+        through[n] = buffers;
+    }
+
+    std::vector<Index>         logic;   // modules other than IO buffers
+    std::vector<std::uint64_t> label(modules);
+    for (Index m = 0; m < modules; ++m) {
+        const ModuleSpec& spec = netlist.module_spec(m);
+        std::uint64_t     h    = hash_text(spec.name);
+        for (std::size_t p = 0; p < spec.params.size(); ++p)
+            for (std::uint64_t word : netlist.param(m, p))
+                h = combine(h, word);
+        label[m] = h;
+        if (!spec.is_buffer()) logic.push_back(m);
+    }
+
+    auto net_label = [&](Index net) {
+        if (net == CompactNetlist::NONE) return OPEN_PIN;
+        const Index at  = source[net];
+        const Index pin = netlist.driver(at);
+        if (pin == CompactNetlist::NONE)
+            return combine(combine(UNDRIVEN_SEED, static_cast<std::uint64_t>(netlist.net_type(at))), through[net]);
+        const Index module = netlist.pin_module(pin);
+        return combine(combine(label[module], pin - netlist.first_pin(module)), through[net]);
+    };
+
+    auto logic_labels = [&] {
+        std::vector<std::uint64_t> result;
+        result.reserve(logic.size());
+        for (Index m : logic) result.push_back(label[m]);
+        return result;
+    };
+
+    // A round splits classes or leaves the partition as it is for good, so
+    // at most one round per module
+    std::vector<std::uint64_t> next(modules);
+    std::size_t                classes = count_distinct(logic_labels());
+    for (std::size_t round = 0; round < logic.size(); ++round) {
+        for (Index m : logic) {
+            std::uint64_t h     = label[m];
+            const Index   first = netlist.first_pin(m);
+            const Index   end   = first + netlist.module_spec(m).input_bits;
+            for (Index pin = first; pin < end; ++pin)
+                h = combine(h, net_label(netlist.pin_net(pin)));
+            next[m] = h;
+        }
+        for (Index m : logic) label[m] = next[m];
+
+        const std::size_t refined = count_distinct(logic_labels());
+        if (refined == classes) break;
+        classes = refined;
+    }
+
+    std::vector<std::uint64_t> outputs;
+    for (Index n = 0; n < nets; ++n)
+        if (netlist.net_type(n) == NetType::EXT_OUT)
+            outputs.push_back(net_label(n));
+
+    std::vector<std::uint64_t> labels = logic_labels();
+    std::sort(labels.begin(), labels.end());
+    std::sort(outputs.begin(), outputs.end());
+
+    std::uint64_t h = combine(0, labels.size());
+    for (std::uint64_t l : labels) h = combine(h, l);
+    h = combine(h, OUTPUTS_SEED);
+    for (std::uint64_t l : outputs) h = combine(h, l);
+    return h;
+}
+
+std::string fingerprint_text(std::uint64_t fingerprint) {
+    std::ostringstream text;
+    text << std::hex << std::setw(16) << std::setfill('0') << fingerprint;
+    return text.str();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "compact_netlist.hpp"
+
+#include <cstdint>
+#include <string>
+
+// Hash of a netlist's structure: the same for netlists that differ only in
+// ids, names and the order of their nets and modules. Not canonical: equal
+// hashes do not mean isomorphic netlists, see below.
+//
+// Weisfeiler-Lehman (1-dimensional colour) refinement over the modules. A module starts labelled by
+// its cell and parameter values, INIT included. Each round it folds in the
+// labels of the nets on its input pins in pin order, a net being labelled by
+// the module and output pin driving it, or by its type if undriven. A net
+// behind IO buffers (see ModuleSpec::is_buffer) is labelled by what drives
+// the first buffer and by the buffers' cells, so an IBUF and a BUFG on the
+// same port differ. Rounds stop when one splits no class of modules
+// further, each linear in pins.
+// The hash combines the sorted labels of the modules and of the top outputs,
+// so top inputs that feed nothing do not count.
+//
+// Labels hash fan-in cones: two designs agree if every module sees the same
+// cone, which some different designs do. Two FDREs each feeding itself and
+// two feeding each other hash the same, as does any pair of designs colour
+// refinement cannot tell apart, besides 64-bit collisions. Reduce treats a
+// repeated fingerprint as ALREADY_SEEN and the fuzzer.sh result cache skips
+// Vivado on one, so either can pass over a new design; the cache is off by
+// default (USE_RESULT_CACHE) for that reason.
+std::uint64_t structural_hash(const CompactNetlist& netlist);
+
+// 16 hex digits, the form stats JSON carries, as jq would round a number
+std::string fingerprint_text(std::uint64_t fingerprint);
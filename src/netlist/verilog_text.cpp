@@ -0,0 +1,33 @@
+#include "verilog_text.hpp"
+
+#include <stdexcept>
+
+std::size_t format_padded_id(char* out, std::uint32_t id, int width) {
+    char digits[16];
+    const std::size_t digit_count = static_cast<std::size_t>(std::to_chars(digits, digits + sizeof(digits), id).ptr - digits);
+    if (static_cast<std::size_t>(width) < digit_count) throw std::invalid_argument("Width too small for ID");
+
+    out[0] = '_';
+    std::memset(out + 1, '0', width - digit_count);
+    std::memcpy(out + 1 + width - digit_count, digits, digit_count);
+    out[width + 1] = '_';
+    return static_cast<std::size_t>(width) + 2;
+}
+
+VerilogKindText::VerilogKindText(const ModuleSpec& spec) {
+    auto param_open = [&](std::size_t i) {
+        return "    ." + spec.params[i].name + "(" + std::to_string(spec.params[i].width) + "'b";
+    };
+
+    head = "  " + spec.name + (spec.params.empty() ? " " : " #(\n" + param_open(0));
+    for (std::size_t i = 0; i < spec.params.size(); ++i)
+        param_text.push_back(i + 1 < spec.params.size() ? "),\n" + param_open(i + 1) : ")\n  ) ");
+
+    const std::size_t port_count = spec.inputs.size() + spec.outputs.size();
+    for (const auto* ports : {&spec.inputs, &spec.outputs})
+        for (const auto& port : *ports) {
+            port_text.push_back("    ." + port.name + (port.width > 1 ? "({" : "("));
+            port_close.push_back(std::string(port.width > 1 ? "}" : "") +
+                                 (port_text.size() < port_count ? "),\n" : ")\n"));
+        }
+}
@@ -0,0 +1,128 @@
+#include "batch.hpp"
+#include "orchestrator.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace fuznet {
+
+Batch::Batch(const std::string& lib_yaml,
+             const std::string& config_toml,
+             bool               verbose,
+             bool               animate,
+             bool               json_stats,
+             bool               snapshot,
+             bool               trace,
+             const Feedback*    feedback)
+    : library_yaml(lib_yaml),
+      config_toml(config_toml),
+      verbose(verbose),
+      animate(animate),
+      json_stats(json_stats),
+      snapshot(snapshot),
+      trace(trace),
+      feedback(feedback) {}
+
+void Batch::run(const std::string& output_prefix, unsigned first_seed, int count, int threads) {
+    if (count < 1)
+        throw std::runtime_error("--count must be at least 1");
+    if (threads < 1)
+        throw std::runtime_error("--threads must be at least 1");
+    threads = std::min(threads, count);
+
+    const auto library = feedback ? feedback->load_library(library_yaml)
+                                  : std::make_shared<const Library>(library_yaml);
+
+    std::vector<std::unique_ptr<Orchestrator>> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.push_back(std::make_unique<Orchestrator>(library, library_yaml, config_toml, first_seed,
+                                                         verbose, animate, json_stats, snapshot, trace, feedback));
+    if (verbose)
+        workers[0]->print_config();
+
+    auto generate = [&](Orchestrator& orch, int i) {
+        const unsigned seed = first_seed + static_cast<unsigned>(i);
+        orch.reseed(seed);
+        orch.run(output_prefix + "_" + std::to_string(seed));
+    };
+
+    if (threads == 1) {
+        for (int i = 0; i < count; ++i)
+            generate(*workers[0], i);
+        return;
+    }
+
+    const int                window = 2 * threads;
+    std::mutex               mutex;
+    std::condition_variable  changed;
+    std::vector<std::string> reports(count);
+    std::vector<bool>        done(count, false);
+    int                      next    = 0;  // next seed index to claim
+    int                      printed = 0;  // reports printed so far
+    bool                     stop    = false;
+    std::exception_ptr       error;
+
+    auto work = [&](Orchestrator& orch) {
+        std::ostringstream report;
+        report.copyfmt(std::cout);  // as if printed directly, see threads == 1
+        orch.set_output(report);
+
+        while (true) {
+            int i;
+            {
+                std::unique_lock lock(mutex);
+                if (stop || next >= count) return;
+                i = next++;
+                changed.wait(lock, [&] { return stop || i < printed + window; });
+                if (stop) return;
+            }
+
+            try {
+                report.str("");
+                generate(orch, i);
+            } catch (...) {
+                std::lock_guard lock(mutex);
+                if (!error) error = std::current_exception();
+                stop = true;
+                changed.notify_all();
+                return;
+            }
+
+            std::lock_guard lock(mutex);
+            reports[i] = report.str();
+            done[i]    = true;
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (auto& orch : workers)
+        pool.emplace_back(work, std::ref(*orch));
+
+    while (true) {
+        std::string text;
+        {
+            std::unique_lock lock(mutex);
+            changed.wait(lock, [&] { return stop || printed == count || done[printed]; });
+            if (stop || printed == count) break;
+            text.swap(reports[printed]);
+            ++printed;
+            changed.notify_all();
+        }
+        std::cout << text;
+    }
+
+    for (auto& thread : pool)
+        thread.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+}
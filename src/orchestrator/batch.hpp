@@ -0,0 +1,43 @@
+#pragma once
+
+#include "feedback.hpp"
+
+#include <string>
+
+namespace fuznet {
+
+// Generates the designs for seeds first_seed .. first_seed + count - 1, each
+// to <output_prefix>_<seed>. Every worker thread owns an Orchestrator, and so
+// its own RNG and Netlist, while the library is parsed once and shared. A
+// design's files depend only on its seed, never on the thread count.
+//
+// Verbose reports are buffered per design and printed in seed order. A worker
+// does not start a design more than a few seeds ahead of the last one
+// printed, which bounds what waits in memory behind a slow design.
+class Batch {
+public:
+    Batch(const std::string& lib_yaml,
+          const std::string& config_toml,
+          bool               verbose    = false,
+          bool               animate    = false,
+          bool               json_stats = false,
+          bool               snapshot   = false,
+          bool               trace      = false,
+          const Feedback*    feedback   = nullptr);
+
+    void run(const std::string& output_prefix, unsigned first_seed, int count, int threads = 1);
+
+private:
+    std::string library_yaml;
+    std::string config_toml;
+
+    bool        verbose    = false;
+    bool        animate    = false;
+    bool        json_stats = false;
+    bool        snapshot   = false;
+    bool        trace      = false;
+
+    const Feedback* feedback = nullptr;  // not owned, outlives run()
+};
+
+}
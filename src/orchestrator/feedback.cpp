@@ -0,0 +1,150 @@
+#include "feedback.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace fuznet {
+
+namespace {
+
+// Bugs credited to and Vivado seconds charged to one name
+struct Exposure {
+    double bugs    = 0.0;
+    double seconds = 0.0;
+};
+
+struct Design {
+    bool                          bug;
+    double                        seconds;  // < 0 when not recorded
+    std::map<std::string, double> primitives;
+    std::map<std::string, double> commands;
+};
+
+Design parse_design(const nlohmann::json& line) {
+    Design design;
+    design.bug     = line.at("result").get<std::string>().starts_with("reduction_new_bug");
+    design.seconds = line.contains("vivado_seconds") ? line["vivado_seconds"].get<double>() : -1.0;
+
+    if (line.contains("primitives"))
+        for (const auto& [name, count] : line["primitives"].items())
+            design.primitives[name] = count.get<double>();
+    if (line.contains("commands"))
+        for (const auto& command : line["commands"])
+            design.commands[command.at("name").get<std::string>()] =
+                command.contains("executed") ? command["executed"].get<double>() : command.at("weight").get<double>();
+    return design;
+}
+
+// Spreads the design over `shares` in proportion to their values
+void expose(std::map<std::string, Exposure>& exposure, const std::map<std::string, double>& shares,
+            bool bug, double seconds) {
+    double total = 0.0;
+    for (const auto& [name, share] : shares) total += share;
+    if (total <= 0.0) return;
+
+    for (const auto& [name, share] : shares) {
+        Exposure& e = exposure[name];
+        if (bug) e.bugs += share / total;
+        e.seconds += seconds * share / total;
+    }
+}
+
+std::map<std::string, double> scales(const std::map<std::string, Exposure>& exposure, double rate, double prior) {
+    std::map<std::string, double> result;
+    if (rate <= 0.0) return result;
+
+    for (const auto& [name, e] : exposure) {
+        const double smoothed = (e.bugs + prior * rate) / (e.seconds + prior);
+        result[name] = std::clamp(smoothed / rate, 1.0 / Feedback::MAX_SCALE, Feedback::MAX_SCALE);
+    }
+    return result;
+}
+
+double scale_of(const std::map<std::string, double>& scale, const std::string& name) {
+    auto it = scale.find(name);
+    return it == scale.end() ? 1.0 : it->second;
+}
+
+}
+
+// Designs without a Vivado time are charged the mean of those with one, or
+// 1 second each if none has
+Feedback Feedback::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.is_open())
+        throw std::runtime_error("Could not open feedback: " + path);
+
+    std::vector<Design> parsed;
+    std::string         text;
+    for (int line_no = 1; std::getline(in, text); ++line_no) {
+        if (text.find_first_not_of(" \t\r") == std::string::npos) continue;
+        try {
+            parsed.push_back(parse_design(nlohmann::json::parse(text)));
+        } catch (const nlohmann::json::exception& e) {
+            throw std::runtime_error("Bad feedback at " + path + ":" + std::to_string(line_no) + ": " + e.what());
+        }
+    }
+
+    double timed_seconds = 0.0;
+    int    timed         = 0;
+    for (const Design& design : parsed)
+        if (design.seconds >= 0.0) {
+            timed_seconds += design.seconds;
+            ++timed;
+        }
+    const double default_seconds = timed > 0 ? timed_seconds / timed : 1.0;
+
+    Feedback feedback;
+    feedback.path = path;
+
+    std::map<std::string, Exposure> primitives;
+    std::map<std::string, Exposure> commands;
+    for (const Design& design : parsed) {
+        const double seconds = design.seconds >= 0.0 ? design.seconds : default_seconds;
+        ++feedback.designs;
+        feedback.bugs    += design.bug;
+        feedback.seconds += seconds;
+        expose(primitives, design.primitives, design.bug, seconds);
+        expose(commands,   design.commands,   design.bug, seconds);
+    }
+    if (feedback.seconds <= 0.0) return feedback;
+
+    const double rate  = feedback.bugs / feedback.seconds;
+    const double prior = PRIOR_DESIGNS * feedback.seconds / feedback.designs;
+    feedback.module_scale  = scales(primitives, rate, prior);
+    feedback.command_scale = scales(commands,   rate, prior);
+    return feedback;
+}
+
+std::shared_ptr<const Library> Feedback::load_library(const std::string& source) const {
+    std::map<std::string, int> weights = Library(source).weights();
+    for (auto& [name, weight] : weights)
+        if (weight > 0)
+            weight = std::max(1, static_cast<int>(std::lround(weight * scale_of(module_scale, name))));
+    return std::make_shared<const Library>(source, weights);
+}
+
+double Feedback::command_weight(const std::string& name, double weight) const {
+    return weight * scale_of(command_scale, name);
+}
+
+void Feedback::print(std::ostream& os) const {
+    os << "\n=== feedback: " << path << " ===\n";
+    os << "designs:                  " << designs << '\n';
+    os << "new bugs:                 " << bugs    << '\n';
+    os << "bugs per Vivado hour:     " << (seconds > 0.0 ? bugs * 3600.0 / seconds : 0.0) << "\n\n";
+    os << "      --- command scales ---\n";
+    for (const auto& [name, scale] : command_scale)
+    os << std::left << std::setw(26) << name << " : " << scale << '\n';
+    os << "\n     --- primitive scales ---\n";
+    for (const auto& [name, scale] : module_scale)
+    os << std::left << std::setw(26) << name << " : " << scale << '\n';
+    os << "======================================\n\n";
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "library.hpp"
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace fuznet {
+
+// What a fuzzing campaign has found so far, read back to steer generation
+// toward the primitives and commands of the designs that found new bugs.
+//
+// The file has one JSON object per line, one line per design, as
+// scripts/fuzzer.sh appends them:
+//
+//   {"result": "reduction_new_bug_small", "vivado_seconds": 412.5,
+//    "commands": [{"name": "AddRandomModule", "weight": 60, "executed": 14}, ...],
+//    "primitives": {"LUT6": 120, "FDRE": 31, ...}}
+//
+// which is the design's -j stats with the result and Vivado time added. A
+// design found a new bug if its result is reduction_new_bug_*, as the
+// reducer only ends there on a fingerprint it has not seen before. Each
+// design credits its bug, and charges its Vivado time, to its primitives by
+// their share of its modules and to its commands by their share of the
+// commands it executed (of its weights, if that was not recorded).
+//
+// A name's scale is its bugs per Vivado second over the campaign's, pulled
+// toward 1 by a prior of PRIOR_DESIGNS designs at the campaign rate and kept
+// within [1 / MAX_SCALE, MAX_SCALE], so little evidence moves little and
+// nothing is starved.
+//
+// Scales always apply to the weights in the library and settings, never to
+// weights a previous feedback run produced, so a campaign does not drift.
+class Feedback {
+public:
+    static constexpr double MAX_SCALE     = 4.0;
+    static constexpr double PRIOR_DESIGNS = 4.0;
+
+    static Feedback load(const std::string& path);
+
+    // `source` loaded with its module weights scaled. A module weighted 0
+    // stays 0, any other stays at least 1.
+    std::shared_ptr<const Library> load_library(const std::string& source) const;
+    double                         command_weight(const std::string& name, double weight) const;
+
+    void print(std::ostream& os = std::cout) const;
+
+private:
+    std::string                   path;
+    int                           designs{0};
+    int                           bugs{0};
+    double                        seconds{0.0};
+    std::map<std::string, double> module_scale;   // absent means 1
+    std::map<std::string, double> command_scale;
+};
+
+}
@@ -1,7 +1,10 @@
 #include "orchestrator.hpp"
+#include "netlist_file.hpp"
+#include "structural_hash.hpp"
 
 #include <chrono>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <random>
@@ -18,18 +21,102 @@ Orchestrator::Orchestrator(const std::string& lib_yaml,
                            unsigned           seed,
                            bool               verbose,
                            bool               animate,
-                           bool               json_stats)
+                           bool               json_stats,
+                           bool               snapshot,
+                           bool               trace,
+                           const Feedback*    feedback)
+    : Orchestrator(feedback ? feedback->load_library(lib_yaml) : std::make_shared<const Library>(lib_yaml),
+                   lib_yaml, config_toml, seed, verbose, animate, json_stats, snapshot, trace, feedback) {
+    if (verbose)
+        print_config();
+}
+
+Orchestrator::Orchestrator(std::shared_ptr<const Library> library,
+                           const std::string&             lib_yaml,
+                           const std::string&             config_toml,
+                           unsigned                       seed,
+                           bool                           verbose,
+                           bool                           animate,
+                           bool                           json_stats,
+                           bool                           snapshot,
+                           bool                           trace,
+                           const Feedback*                feedback)
     : library_yaml(lib_yaml),
       config_toml(config_toml),
       seed(seed),
       rng(seed),
-      library(lib_yaml, rng),
-      netlist(library, rng),
+      library(std::move(library)),
+      netlist(*this->library, rng),
       verbose(verbose),
       animate(animate),
-      json_stats(json_stats)
+      json_stats(json_stats),
+      snapshot(snapshot),
+      trace(trace)
     {
 
+    make_commands();
+    load_config();
+    if (feedback)
+        for (auto& entry : commands)
+            entry.weight = feedback->command_weight(entry.cmd->name(), entry.weight);
+    apply_settings();
+    add_start_nets();
+}
+
+Orchestrator::Orchestrator(const Trace& recorded,
+                           bool         verbose,
+                           bool         json_stats,
+                           bool         snapshot)
+    : library_yaml(recorded.library),
+      config_toml(recorded.config),
+      seed(recorded.seed),
+      rng(seed),
+      library(std::make_shared<const Library>(recorded.library, recorded.module_weights)),
+      netlist(*library, rng),
+      verbose(verbose),
+      json_stats(json_stats),
+      snapshot(snapshot),
+      script(recorded)
+    {
+
+    if (library->fingerprint() != recorded.library_hash)
+        throw std::runtime_error("Library " + recorded.library + " differs from the one the trace was recorded with");
+
+    make_commands();
+    load_trace(recorded);
+    apply_settings();
+    if (verbose)
+        print_config();
+    add_start_nets();
+}
+
+void Orchestrator::reseed(unsigned new_seed) {
+    seed = new_seed;
+    rng.seed(seed);
+    netlist.set_animation_log(nullptr);
+    animation.close();
+    netlist.reset();
+    add_start_nets();
+}
+
+void Orchestrator::add_start_nets() {
+    // Record from the first net, the log is opened once run() has a prefix
+    if (animate)
+        netlist.set_animation_log(&animation);
+
+    std::poisson_distribution<int> undriven_dist (start_undriven_lambda);
+    std::poisson_distribution<int> input_dist    (start_input_lambda);
+
+    start_undriven = undriven_dist(rng);
+    start_inputs   = input_dist(rng);
+    if (script && (start_undriven != script->start_undriven || start_inputs != script->start_inputs))
+        throw std::runtime_error("Replay diverged from the trace in its starting nets");
+
+    netlist.add_undriven_nets(NetType::LOGIC, start_undriven);
+    netlist.add_external_nets(start_inputs);
+}
+
+void Orchestrator::make_commands() {
     commands = {
         { new AddRandomModule(netlist),              1.0 },
         { new AddExternalNet(netlist),               1.0 },
@@ -38,18 +125,6 @@ Orchestrator::Orchestrator(const std::string& lib_yaml,
         { new DriveUndrivenNets(netlist, 0.3, 0.3),  1.0 },
         { new BufferUnconnectedOutputs(netlist),     1.0 }
     };
-
-    load_config();
-
-    std::poisson_distribution<int> undriven_dist (start_undriven_lambda);
-    std::poisson_distribution<int> input_dist    (start_input_lambda);
-
-    netlist.add_undriven_nets(NetType::LOGIC, undriven_dist(rng));
-    netlist.add_external_nets(input_dist(rng));
-
-    std::vector<double> weights;
-    for (const auto& entry : commands) weights.push_back(entry.weight);
-    weight_dist = std::discrete_distribution<int>(weights.begin(), weights.end());
 }
 
 void Orchestrator::load_config() {
@@ -72,6 +147,39 @@ void Orchestrator::load_config() {
     seq_mod_prob          = set["prob_sequential_module"].value_or(0.2);
     seq_port_prob         = set["prob_sequential_port"].value_or(0.2);
 
+    budget.clear();
+    if (auto table = cfg["budget"].as_table())
+        for (const auto& [name, limit] : *table) {
+            auto value = limit.value<int>();
+            if (!value || *value < 0)
+                throw std::runtime_error("Budget for '" + std::string(name.str()) + "' must be a count");
+            budget[std::string(name.str())] = *value;
+        }
+}
+
+// Weights are matched by position, as the draws depend on their order
+void Orchestrator::load_trace(const Trace& recorded) {
+    bool same_commands = recorded.commands.size() == commands.size();
+    for (std::size_t i = 0; same_commands && i < commands.size(); ++i)
+        same_commands = recorded.commands[i].name == commands[i].cmd->name();
+    if (!same_commands)
+        throw std::runtime_error("Trace was recorded with different commands than this build has");
+
+    for (std::size_t i = 0; i < commands.size(); ++i)
+        commands[i].weight = recorded.commands[i].weight;
+
+    max_iter              = recorded.max_iter;
+    stop_iter_lambda      = recorded.stop_iter_lambda;
+    start_input_lambda    = recorded.start_input_lambda;
+    start_undriven_lambda = recorded.start_undriven_lambda;
+    seq_mod_prob          = recorded.seq_mod_prob;
+    seq_port_prob         = recorded.seq_port_prob;
+    budget                = recorded.budget;
+}
+
+void Orchestrator::apply_settings() {
+    netlist.set_budget(budget);
+
     DriveUndrivenNet*  drive_one   = nullptr;
     DriveUndrivenNets* drive_many  = nullptr;
 
@@ -88,67 +196,177 @@ void Orchestrator::load_config() {
         drive_many->seq_port_prob = seq_port_prob;
     }
 
-    if (!verbose) return;
+    std::vector<double> weights;
+    for (const auto& entry : commands) weights.push_back(entry.weight);
+    weight_dist = std::discrete_distribution<int>(weights.begin(), weights.end());
+}
 
-    std::cout << "\n=== settings: " << config_toml << " ===\n";
-    std::cout << "max_iter:                 " << max_iter              << '\n';
-    std::cout << "stop_iter_lambda:         " << stop_iter_lambda      << '\n';
-    std::cout << "start_input_lambda:       " << start_input_lambda    << '\n';
-    std::cout << "start_undriven_lambda:    " << start_undriven_lambda << '\n';
-    std::cout << "prob_sequential_module:   " << seq_mod_prob          << "\n";
-    std::cout << "prob_sequential_port:     " << seq_port_prob         << "\n\n";
-    std::cout << "      --- command weights ---\n";
+void Orchestrator::print_config() const {
+    *out << "\n=== settings: " << config_toml << " ===\n";
+    *out << "max_iter:                 " << max_iter              << '\n';
+    *out << "stop_iter_lambda:         " << stop_iter_lambda      << '\n';
+    *out << "start_input_lambda:       " << start_input_lambda    << '\n';
+    *out << "start_undriven_lambda:    " << start_undriven_lambda << '\n';
+    *out << "prob_sequential_module:   " << seq_mod_prob          << "\n";
+    *out << "prob_sequential_port:     " << seq_port_prob         << "\n\n";
+    *out << "      --- command weights ---\n";
     for (const auto& entry : commands)
-    std::cout << std::left << std::setw(26) << entry.cmd->name() << " : " << entry.weight << '\n';
-    std::cout << "======== Configuration Loaded ========\n";
-    std::cout << "======================================\n\n";
+    *out << std::left << std::setw(26) << entry.cmd->name() << " : " << entry.weight << '\n';
+    if (!budget.empty())
+    *out << "\n          --- budget ---\n";
+    for (const auto& [name, limit] : budget)
+    *out << std::left << std::setw(26) << name << " : " << limit << '\n';
+    *out << "======== Configuration Loaded ========\n";
+    *out << "======================================\n\n";
 }
 
-void Orchestrator::run(const std::string& output_prefix) {
+CompactNetlist Orchestrator::run(const std::string& output_prefix) {
     std::poisson_distribution<int> stop_dist(stop_iter_lambda);
     int iterations = std::min(stop_dist(rng), max_iter);
+    if (script && static_cast<std::size_t>(iterations) != script->executed.size())
+        throw std::runtime_error("Replay diverged from the trace in its iteration count");
 
     std::string verilog_path = output_prefix + ".v";
 
-    auto dump_dot = [&](int iter = 0) {
-        std::ofstream file(output_prefix + "_iter" + std::to_string(iter) + ".dot", std::ios::trunc);
-        netlist.emit_dotfile(file, "top");
-        file.close();
-    };
+    if (animate) animation.open(output_prefix + ".anim");
 
     netlist.add_initial_nets();
-    if (animate) dump_dot(0);
+    if (animate) animation.step();
 
+    executed.clear();
     for (int i = 0; i < iterations; ++i) {
-        commands[weight_dist(rng)].cmd->execute();
-        if (animate) dump_dot(i + 1);
+        const auto chosen = static_cast<std::uint32_t>(weight_dist(rng));
+        if (script && chosen != script->executed[i])
+            throw std::runtime_error("Replay diverged from the trace at command " + std::to_string(i));
+        executed.push_back(chosen);
+
+        commands[chosen].cmd->execute();
+        if (animate) animation.step();
     }
     
     netlist.drive_undriven_nets(seq_mod_prob, seq_port_prob);
     netlist.buffer_unconnected_outputs();
+
+    if (animate) {
+        animation.step();
+        animation.close();
+        netlist.set_animation_log(nullptr);
+    }
     
+    CompactNetlist result = netlist.compact();
+
+    std::optional<std::uint64_t> fingerprint;
+    if (trace || json_stats || script)
+        fingerprint = structural_hash(result);
+    if (script && *fingerprint != script->fingerprint)
+        throw std::runtime_error("Replay diverged from the trace in the netlist it built");
+
     std::ofstream v(verilog_path);
-    netlist.emit_verilog(v, "top");
+    result.emit_verilog(v, "top");
     
-    dump_dot(iterations + 1);
+    std::ofstream dot(output_prefix + "_iter" + std::to_string(iterations + 1) + ".dot", std::ios::trunc);
+    result.emit_dotfile(dot, "top");
+    dot.close();
 
-    nlohmann::json json_save;
-    json_save["new"] = netlist.json();
-    std::ofstream json_file(output_prefix + ".json");
-    json_file << std::setw(4) << json_save << std::endl;
-    json_file.close();
+    NetlistFile saved;
+    saved.current = result;
+    if (snapshot)
+        saved.save_snapshot(output_prefix + ".fzn");
+    else
+        saved.save_json(output_prefix + ".json");
 
     if(verbose) {
-        std::cout << "======== Netlist Generated =========\n";
-        netlist.print();
-        std::cout << "====================================\n\n";
+        *out << "======== Netlist Generated =========\n";
+        netlist.print(true, *out);
+        *out << "====================================\n\n";
+    }
+
+    if (trace)
+        make_trace(*fingerprint).save(output_prefix + ".trace");
+
+    if (json_stats)
+        json_dump(output_prefix, netlist.get_stats(), fingerprint);
+
+    return result;
+}
+
+Trace Orchestrator::make_trace(std::uint64_t fingerprint) const {
+    Trace recorded;
+    recorded.library               = library_yaml;
+    recorded.library_hash          = library->fingerprint();
+    recorded.config                = config_toml;
+    recorded.seed                  = seed;
+    recorded.max_iter              = max_iter;
+    recorded.stop_iter_lambda      = stop_iter_lambda;
+    recorded.start_input_lambda    = start_input_lambda;
+    recorded.start_undriven_lambda = start_undriven_lambda;
+    recorded.seq_mod_prob          = seq_mod_prob;
+    recorded.seq_port_prob         = seq_port_prob;
+    recorded.budget                = budget;
+    recorded.module_weights        = library->weights();
+    for (const auto& entry : commands)
+        recorded.commands.push_back({entry.cmd->name(), entry.weight});
+    recorded.start_undriven        = start_undriven;
+    recorded.start_inputs          = start_inputs;
+    recorded.executed              = executed;
+    recorded.fingerprint           = fingerprint;
+    return recorded;
+}
+
+void Orchestrator::run_stream(const std::string& output_prefix, long long module_target, std::size_t frontier) {
+    if (module_target < 1)
+        throw std::runtime_error("Module target must be at least 1");
+
+    StreamNetlist stream(*library, rng, output_prefix + ".v", frontier, seq_mod_prob, seq_port_prob);
+
+    // Same draws as add_start_nets, taken for this netlist instead
+    std::poisson_distribution<int> undriven_dist (start_undriven_lambda);
+    std::poisson_distribution<int> input_dist    (start_input_lambda);
+
+    stream.add_undriven_nets(undriven_dist(rng));
+    stream.add_external_nets(input_dist(rng));
+    stream.add_initial_nets();
+
+    // Parallel to commands, by command name
+    std::vector<std::function<void()>> actions;
+    for (const auto& entry : commands) {
+        const std::string name = entry.cmd->name();
+        if      (name == "AddRandomModule")          actions.push_back([&] { stream.add_random_module(); });
+        else if (name == "AddExternalNet")           actions.push_back([&] { stream.add_external_nets(); });
+        else if (name == "AddUndriveNet")            actions.push_back([&] { stream.add_undriven_nets(); });
+        else if (name == "DriveUndrivenNet")         actions.push_back([&] { stream.drive_undriven_nets(true); });
+        else if (name == "DriveUndrivenNets")        actions.push_back([&] { stream.drive_undriven_nets(); });
+        else if (name == "BufferUnconnectedOutputs") actions.push_back([&] { stream.buffer_unconnected_outputs(); });
+        else throw std::runtime_error("No streaming form of command: " + name);
+    }
+
+    // Only these add modules whatever the state, anything else could spin
+    double growth = 0.0;
+    for (const auto& entry : commands) {
+        const std::string name = entry.cmd->name();
+        if (name == "AddRandomModule" || name == "AddExternalNet" || name == "AddUndriveNet")
+            growth += entry.weight;
+    }
+    if (growth <= 0.0)
+        throw std::runtime_error("Streaming needs AddRandomModule, AddExternalNet or AddUndriveNet weighted above 0");
+
+    while (stream.get_stats().total_modules < module_target)
+        actions[weight_dist(rng)]();
+
+    stream.finish("top");
+
+    if (verbose) {
+        *out << "======== Netlist Generated =========\n";
+        stream.get_stats().print(*out);
+        *out << "====================================\n\n";
     }
 
     if (json_stats)
-        json_dump(output_prefix);
+        json_dump(output_prefix, stream.get_stats());
 }
 
-void Orchestrator::json_dump(const std::string& output_prefix) const {
+void Orchestrator::json_dump(const std::string& output_prefix, const NetlistStats& stats,
+                             std::optional<std::uint64_t> fingerprint) const {
     nlohmann::json json_data;
 
     json_data["library"] = library_yaml;
@@ -165,15 +383,19 @@ void Orchestrator::json_dump(const std::string& output_prefix) const {
         {"seq_port_prob", seq_port_prob}
     };
     
-    for (const auto& entry : commands) {
+    // How often each ran, known only for a run() design
+    std::vector<int> ran(commands.size(), 0);
+    for (std::uint32_t index : executed) ++ran[index];
+
+    for (std::size_t i = 0; i < commands.size(); ++i) {
         json_data["commands"].push_back({
-            {"name", entry.cmd->name()},
-            {"weight", entry.weight}
+            {"name", commands[i].cmd->name()},
+            {"weight", commands[i].weight}
         });
+        if (!executed.empty())
+            json_data["commands"].back()["executed"] = ran[i];
     }
 
-    auto stats = netlist.get_stats();
-
     json_data["netlist_stats"] = {
         {"input_nets", stats.input_nets},
         {"output_nets", stats.output_nets},
@@ -183,11 +405,23 @@ void Orchestrator::json_dump(const std::string& output_prefix) const {
         {"total_modules", stats.total_modules}
     };
 
+    for (const auto& [name, used] : stats.resources)
+        json_data["netlist_stats"]["resources"][name]["used"] = used;
+    for (const auto& [name, limit] : stats.budget) {
+        json_data["netlist_stats"]["resources"][name]["budget"] = limit;
+        if (!stats.resources.contains(name))
+            json_data["netlist_stats"]["resources"][name]["used"] = 0;
+    }
+
+    json_data["netlist_stats"]["primitives"] = stats.primitives;
+    if (fingerprint)
+        json_data["netlist_stats"]["fingerprint"] = fingerprint_text(*fingerprint);
+
     std::ofstream json_file(output_prefix + "_stats.json");
     json_file << std::setw(4) << json_data << std::endl;
     json_file.close();
     if (verbose) {
-        std::cout << "JSON stats written to: " << output_prefix << ".json\n";
+        *out << "JSON stats written to: " << output_prefix << ".json\n";
     }
 }
 
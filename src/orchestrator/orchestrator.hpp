@@ -1,13 +1,20 @@
 #pragma once
 
+#include <iostream>
+#include <memory>
+#include <optional>
 #include <random>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "animation_log.hpp"
 #include "library.hpp"
 #include "netlist.hpp"
+#include "stream_netlist.hpp"
 #include "commands.hpp"
+#include "feedback.hpp"
+#include "trace.hpp"
 
 namespace fuznet {
 
@@ -18,15 +25,60 @@ public:
                  unsigned           seed        = std::random_device{}(),
                  bool               verbose     = false,
                  bool               animate     = false,
-                 bool               json_stats  = false);
+                 bool               json_stats  = false,
+                 bool               snapshot    = false,
+                 bool               trace       = false,
+                 const Feedback*    feedback    = nullptr);
 
-    void run(const std::string& output_prefix);
+    // Shares an already loaded library; lib_yaml is only reported in stats.
+    // With feedback, the library should come from its load_library.
+    // Prints nothing while constructing, see print_config.
+    Orchestrator(std::shared_ptr<const Library> library,
+                 const std::string&             lib_yaml,
+                 const std::string&             config_toml,
+                 unsigned                       seed,
+                 bool                           verbose    = false,
+                 bool                           animate    = false,
+                 bool                           json_stats = false,
+                 bool                           snapshot   = false,
+                 bool                           trace      = false,
+                 const Feedback*                feedback   = nullptr);
+
+    // Rebuilds the run `recorded` was made from: run() then executes its
+    // commands, failing on a library, command pick or resulting netlist that
+    // differs from the trace (see Trace)
+    Orchestrator(const Trace& recorded,
+                 bool         verbose    = false,
+                 bool         json_stats = false,
+                 bool         snapshot   = false);
+
+    // Returns the netlist it wrote
+    CompactNetlist run(const std::string& output_prefix);
+
+    // Generates until the design has `module_target` modules, writing each
+    // to <output_prefix>.v as it is placed so memory stays bounded, see
+    // StreamNetlist. Only the Verilog (and -j stats) are written.
+    void run_stream(const std::string& output_prefix, long long module_target, std::size_t frontier);
+    void print_config() const;
+
+    // Where verbose reports go, std::cout by default
+    void set_output(std::ostream& os) { out = &os; }
+
+    // Start the next design from `seed`, as a new Orchestrator would, but
+    // without parsing the library and settings again
+    void reseed(unsigned seed);
 
     ~Orchestrator();
 
 private:
+    void make_commands();
     void load_config();
-    void json_dump(const std::string& output_prefix) const;
+    void load_trace(const Trace& recorded);
+    void apply_settings();
+    void add_start_nets();
+    Trace make_trace(std::uint64_t fingerprint) const;
+    void json_dump(const std::string& output_prefix, const NetlistStats& stats,
+                   std::optional<std::uint64_t> fingerprint = std::nullopt) const;
 
     struct Entry {
         ICommand* cmd;
@@ -39,10 +91,12 @@ private:
     unsigned    seed;
     
     std::mt19937_64                 rng;
-    Library                         library;
+    AnimationLog                    animation;  // outlives netlist, which writes to it
+    std::shared_ptr<const Library>  library;
     Netlist                         netlist;
     std::vector<Entry>              commands;
     std::discrete_distribution<int> weight_dist;
+    std::ostream*                   out{&std::cout};
 
     int         max_iter               = 0;
     int         stop_iter_lambda       = 0;
@@ -53,6 +107,17 @@ private:
     bool        verbose                = false;
     bool        animate                = false;
     bool        json_stats             = false;
+    bool        snapshot               = false;
+    bool        trace                  = false;
+
+    ResourceCounts budget;  // [budget] in the settings, see Netlist::set_budget
+
+    // What this run has drawn so far, saved as <output>.trace with `trace`
+    int                        start_undriven = 0;
+    int                        start_inputs   = 0;
+    std::vector<std::uint32_t> executed;
+
+    std::optional<Trace>       script;  // the trace being replayed, if any
 };
 
 }
@@ -0,0 +1,202 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace fuznet {
+
+namespace {
+
+constexpr char MAGIC[8] = {'F', 'Z', 'N', 'T', 'R', 'A', 'C', 'E'};
+
+class Writer {
+public:
+    void varint(std::uint64_t value) {
+        while (value >= 0x80) {
+            data.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        data.push_back(static_cast<char>(value));
+    }
+    void text(std::string_view s) {
+        varint(s.size());
+        data += s;
+    }
+    void real(double value) {
+        const auto bits = std::bit_cast<std::uint64_t>(value);
+        for (int i = 0; i < 8; ++i)
+            data.push_back(static_cast<char>(bits >> (8 * i)));
+    }
+
+    std::string data{MAGIC, sizeof(MAGIC)};
+};
+
+class Reader {
+public:
+    Reader(std::string_view data, const std::string& path) : data(data), path(path) {}
+
+    bool done() const { return pos >= data.size(); }
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (done()) truncated();
+            const auto b = static_cast<std::uint8_t>(data[pos++]);
+            value |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return value;
+        }
+        throw std::runtime_error("Corrupt trace: " + path);
+    }
+    int integer() {
+        const std::uint64_t value = varint();
+        if (value > static_cast<std::uint64_t>(std::numeric_limits<int>::max()))
+            throw std::runtime_error("Corrupt trace: " + path);
+        return static_cast<int>(value);
+    }
+    std::string text() {
+        const std::uint64_t size = varint();
+        if (size > data.size() - pos) truncated();
+        std::string s(data.substr(pos, size));
+        pos += size;
+        return s;
+    }
+    double real() {
+        if (data.size() - pos < 8) truncated();
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i)
+            bits |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(data[pos++])) << (8 * i);
+        return std::bit_cast<double>(bits);
+    }
+
+private:
+    [[noreturn]] void truncated() const { throw std::runtime_error("Truncated trace: " + path); }
+
+    std::string_view   data;
+    const std::string& path;
+    std::size_t        pos{sizeof(MAGIC)};
+};
+
+}
+
+void Trace::save(const std::string& path) const {
+    Writer out;
+    out.varint(VERSION);
+
+    out.text(library);
+    out.varint(library_hash);
+    out.text(config);
+    out.varint(seed);
+
+    out.varint(static_cast<std::uint64_t>(max_iter));
+    out.varint(static_cast<std::uint64_t>(stop_iter_lambda));
+    out.varint(static_cast<std::uint64_t>(start_input_lambda));
+    out.varint(static_cast<std::uint64_t>(start_undriven_lambda));
+    out.real(seq_mod_prob);
+    out.real(seq_port_prob);
+
+    out.varint(budget.size());
+    for (const auto& [name, limit] : budget) {
+        out.text(name);
+        out.varint(static_cast<std::uint64_t>(limit));
+    }
+
+    out.varint(module_weights.size());
+    for (const auto& [name, weight] : module_weights) {
+        out.text(name);
+        out.varint(static_cast<std::uint64_t>(weight));
+    }
+
+    out.varint(commands.size());
+    for (const Command& command : commands) {
+        out.text(command.name);
+        out.real(command.weight);
+    }
+
+    out.varint(static_cast<std::uint64_t>(start_undriven));
+    out.varint(static_cast<std::uint64_t>(start_inputs));
+    out.varint(executed.size());
+    for (std::uint32_t index : executed)
+        out.varint(index);
+    out.varint(fingerprint);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Could not write trace: " + path);
+    file.write(out.data.data(), static_cast<std::streamsize>(out.data.size()));
+}
+
+Trace Trace::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        throw std::runtime_error("Could not open trace: " + path);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    const std::string data = contents.str();
+
+    if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error("Not a trace: " + path);
+
+    Reader reader(data, path);
+    if (const auto version = reader.varint(); version != VERSION)
+        throw std::runtime_error("Unsupported trace version " + std::to_string(version) + ": " + path);
+
+    Trace trace;
+    trace.library      = reader.text();
+    trace.library_hash = reader.varint();
+    trace.config       = reader.text();
+    const std::uint64_t seed = reader.varint();
+    if (seed > std::numeric_limits<unsigned>::max())
+        throw std::runtime_error("Corrupt trace: " + path);
+    trace.seed = static_cast<unsigned>(seed);
+
+    trace.max_iter              = reader.integer();
+    trace.stop_iter_lambda      = reader.integer();
+    trace.start_input_lambda    = reader.integer();
+    trace.start_undriven_lambda = reader.integer();
+    trace.seq_mod_prob          = reader.real();
+    trace.seq_port_prob         = reader.real();
+
+    const int budget_count = reader.integer();
+    for (int i = 0; i < budget_count; ++i) {
+        const std::string name = reader.text();
+        trace.budget[name] = reader.integer();
+    }
+
+    const int weight_count = reader.integer();
+    for (int i = 0; i < weight_count; ++i) {
+        const std::string name = reader.text();
+        trace.module_weights[name] = reader.integer();
+    }
+
+    const int command_count = reader.integer();
+    for (int i = 0; i < command_count; ++i) {
+        Command command;
+        command.name   = reader.text();
+        command.weight = reader.real();
+        trace.commands.push_back(std::move(command));
+    }
+
+    trace.start_undriven = reader.integer();
+    trace.start_inputs   = reader.integer();
+    const int iterations = reader.integer();
+    trace.executed.reserve(static_cast<std::size_t>(std::min(iterations, 1 << 20)));
+    for (int i = 0; i < iterations; ++i) {
+        const std::uint64_t index = reader.varint();
+        if (index >= trace.commands.size())
+            throw std::runtime_error("Corrupt trace: " + path);
+        trace.executed.push_back(static_cast<std::uint32_t>(index));
+    }
+    trace.fingerprint = reader.varint();
+
+    if (!reader.done())
+        throw std::runtime_error("Corrupt trace: " + path);
+    return trace;
+}
+
+}
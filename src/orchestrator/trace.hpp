@@ -0,0 +1,57 @@
+#pragma once
+
+#include "module.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fuznet {
+
+// Everything a generate run needs to be rebuilt without its settings file:
+// the library, seed, settings and module and command weights it ran with,
+// and the commands it executed. Commands draw their choices from the seeded
+// generator, so executing the same commands from the same seed rebuilds the
+// same netlist. The choices made inside a command are not recorded. Replay
+// checks the library's fingerprint, the starting nets, the iteration count
+// and each command picked, then the structural hash of the result, so a
+// library or build that would generate differently fails instead of
+// rebuilding another design.
+//
+// The file is "FZNTRACE", a version varint, then the fields below in order:
+// strings as a varint length and bytes, integers as LEB128 varints, doubles
+// as their 8 bytes little-endian.
+struct Trace {
+    static constexpr std::uint32_t VERSION = 1;
+
+    struct Command {
+        std::string name;
+        double      weight;
+    };
+
+    std::string                library;
+    std::uint64_t              library_hash          = 0;  // Library::fingerprint
+    std::string                config;        // reported in stats only, never read
+    unsigned                   seed                  = 0;
+
+    int                        max_iter              = 0;
+    int                        stop_iter_lambda      = 0;
+    int                        start_input_lambda    = 0;
+    int                        start_undriven_lambda = 0;
+    double                     seq_mod_prob          = 0.0;
+    double                     seq_port_prob         = 0.0;
+    ResourceCounts             budget;
+    std::map<std::string, int> module_weights;  // every module's
+    std::vector<Command>       commands;
+
+    int                        start_undriven = 0;  // drawn from the lambdas above
+    int                        start_inputs   = 0;
+    std::vector<std::uint32_t> executed;            // index into commands, per iteration
+    std::uint64_t              fingerprint    = 0;  // structural_hash of the netlist built
+
+    void         save(const std::string& path) const;
+    static Trace load(const std::string& path);
+};
+
+}
@@ -0,0 +1,286 @@
+#include "fingerprint_store.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fuznet {
+
+namespace {
+
+constexpr char          STORE_MAGIC[8]  = {'F', 'Z', 'N', 'S', 'E', 'E', 'N', '\0'};
+constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t capacity;       // slots, a power of two
+    std::uint64_t count;          // slots in use
+    std::uint64_t next_sequence;
+    std::uint64_t reserved[3];
+};
+static_assert(sizeof(Header) == 64);
+
+using Slot = FingerprintStore::Entry;  // sequence 0 marks an empty slot
+static_assert(sizeof(Slot) == 16);
+
+// Fingerprints may be small or clustered, the slot index needs all bits mixed
+std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+std::uint64_t capacity_for(std::uint64_t count) {
+    return std::max(FingerprintStore::MIN_CAPACITY, std::bit_ceil(2 * count));
+}
+
+std::uint32_t now() {
+    return static_cast<std::uint32_t>(std::time(nullptr));
+}
+
+// The store's file, locked and mapped for the length of one operation
+class LockedTable {
+public:
+    // Locks the file `path` names, exclusively to `write`. Creates it if
+    // `write` and it does not exist; otherwise the table is empty().
+    LockedTable(const std::string& path, bool write) : path(path), write(write) {
+        try {
+            open();
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~LockedTable() { release(); }
+
+    LockedTable(const LockedTable&)            = delete;
+    LockedTable& operator=(const LockedTable&) = delete;
+
+    bool empty() const { return !data; }
+
+    bool contains(std::uint64_t fingerprint) const {
+        return !empty() && slots()[find(fingerprint)].sequence != 0;
+    }
+
+    std::vector<Slot> entries() const {
+        std::vector<Slot> result;
+        if (empty()) return result;
+        result.reserve(header().count);
+        for (std::uint64_t i = 0; i < header().capacity; ++i)
+            if (slots()[i].sequence != 0)
+                result.push_back(slots()[i]);
+        std::sort(result.begin(), result.end(),
+                  [](const Slot& a, const Slot& b) { return a.sequence < b.sequence; });
+        return result;
+    }
+
+    // Adds fingerprints the table does not have, each once, keeping their
+    // added times. Numbered in order after what is there.
+    void add(const std::vector<Slot>& added) {
+        Header& h = header();
+        if ((h.count + added.size()) * 2 <= h.capacity) {
+            for (const Slot& entry : added) {
+                slots()[find(entry.fingerprint)] =
+                    {entry.fingerprint, static_cast<std::uint32_t>(h.next_sequence++), entry.added};
+                ++h.count;
+            }
+            return;
+        }
+
+        std::vector<Slot> all = entries();
+        std::uint64_t     next = h.next_sequence;
+        for (const Slot& entry : added)
+            all.push_back({entry.fingerprint, static_cast<std::uint32_t>(next++), entry.added});
+        rebuild(capacity_for(all.size()), all, next);
+    }
+
+    // Replaces the file with a table of `capacity` slots holding `all`. This
+    // mapping stays on the old file, which is no longer the store.
+    void rebuild(std::uint64_t capacity, const std::vector<Slot>& all, std::uint64_t next_sequence) {
+        std::vector<char> bytes(sizeof(Header) + capacity * sizeof(Slot), 0);
+        auto* h = reinterpret_cast<Header*>(bytes.data());
+        auto* s = reinterpret_cast<Slot*>(bytes.data() + sizeof(Header));
+        std::memcpy(h->magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+        h->version       = FingerprintStore::VERSION;
+        h->byte_order    = BYTE_ORDER_MARK;
+        h->capacity      = capacity;
+        h->count         = all.size();
+        h->next_sequence = next_sequence;
+
+        for (const Slot& entry : all) {
+            std::uint64_t i = mix(entry.fingerprint) & (capacity - 1);
+            while (s[i].sequence != 0)
+                i = (i + 1) & (capacity - 1);
+            s[i] = entry;
+        }
+
+        const std::string temp = path + ".tmp." + std::to_string(::getpid());
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            if (!out)
+                throw std::runtime_error("Could not write fingerprint store: " + temp);
+        }
+        if (std::rename(temp.c_str(), path.c_str()) != 0) {
+            std::remove(temp.c_str());
+            throw std::runtime_error("Could not replace fingerprint store: " + path);
+        }
+    }
+
+    Header&       header()       { return *static_cast<Header*>(data); }
+    const Header& header() const { return *static_cast<const Header*>(data); }
+
+private:
+    void open() {
+        while (true) {
+            fd = ::open(path.c_str(), write ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+            if (fd < 0) {
+                if (errno == ENOENT && !write) return;
+                throw std::runtime_error("Could not open fingerprint store: " + path);
+            }
+            if (::flock(fd, write ? LOCK_EX : LOCK_SH) != 0) {
+                ::close(fd);
+                throw std::runtime_error("Could not lock fingerprint store: " + path);
+            }
+
+            // Rebuilt and renamed over while this waited for the lock
+            struct stat held{}, named{};
+            if (::fstat(fd, &held) == 0 && ::stat(path.c_str(), &named) == 0 &&
+                held.st_dev == named.st_dev && held.st_ino == named.st_ino) {
+                size = static_cast<std::size_t>(held.st_size);
+                break;
+            }
+            ::close(fd);
+        }
+
+        // Created but not yet written: empty, and this writer sets it up
+        if (size == 0) {
+            if (!write) return;
+            size = sizeof(Header) + FingerprintStore::MIN_CAPACITY * sizeof(Slot);
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+                throw std::runtime_error("Could not size fingerprint store: " + path);
+            map();
+            std::memcpy(header().magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+            header().version       = FingerprintStore::VERSION;
+            header().byte_order    = BYTE_ORDER_MARK;
+            header().capacity      = FingerprintStore::MIN_CAPACITY;
+            header().next_sequence = 1;
+            return;
+        }
+
+        if (size < sizeof(Header) || !FingerprintStore::is_store(path))
+            throw std::runtime_error("Not a fingerprint store: " + path);
+        map();
+        if (header().byte_order != BYTE_ORDER_MARK)
+            throw std::runtime_error("Fingerprint store written on a machine of the other byte order: " + path);
+        if (header().version < FingerprintStore::VERSION)
+            throw std::runtime_error("Fingerprint store of an older structural hash, start a new one: " + path);
+        if (header().version != FingerprintStore::VERSION)
+            throw std::runtime_error("Unsupported fingerprint store version " + std::to_string(header().version) + ": " + path);
+        if (!std::has_single_bit(header().capacity) ||
+            size != sizeof(Header) + header().capacity * sizeof(Slot))
+            throw std::runtime_error("Corrupt fingerprint store: " + path);
+    }
+
+    void release() {
+        if (data) ::munmap(data, size);
+        if (fd >= 0) ::close(fd);  // and with it the lock
+        data = nullptr;
+        fd   = -1;
+    }
+
+
+    void map() {
+        data = ::mmap(nullptr, size, write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            data = nullptr;
+            throw std::runtime_error("Could not map fingerprint store: " + path);
+        }
+    }
+
+    Slot*       slots()       { return reinterpret_cast<Slot*>(static_cast<char*>(data) + sizeof(Header)); }
+    const Slot* slots() const { return reinterpret_cast<const Slot*>(static_cast<const char*>(data) + sizeof(Header)); }
+
+    // Index of the slot holding `fingerprint`, or of the empty one it would
+    // go in
+    std::uint64_t find(std::uint64_t fingerprint) const {
+        const std::uint64_t mask = header().capacity - 1;
+        std::uint64_t       i    = mix(fingerprint) & mask;
+        while (slots()[i].sequence != 0 && slots()[i].fingerprint != fingerprint)
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    const std::string& path;
+    bool               write;
+    int                fd{-1};
+    std::size_t        size{0};
+    void*              data{nullptr};
+};
+
+}
+
+FingerprintStore::FingerprintStore(std::string path) : path(std::move(path)) {}
+
+bool FingerprintStore::insert(std::uint64_t fingerprint) const {
+    LockedTable table(path, true);
+    if (table.contains(fingerprint))
+        return false;
+    table.add({{fingerprint, 0, now()}});
+    return true;
+}
+
+bool FingerprintStore::contains(std::uint64_t fingerprint) const {
+    return LockedTable(path, false).contains(fingerprint);
+}
+
+std::vector<FingerprintStore::Entry> FingerprintStore::entries() const {
+    return LockedTable(path, false).entries();
+}
+
+std::size_t FingerprintStore::merge(const std::string& source) const {
+    if (!is_store(source))
+        throw std::runtime_error("Not a fingerprint store: " + source);
+    const std::vector<Entry> incoming = FingerprintStore(source).entries();
+
+    LockedTable                       table(path, true);
+    std::unordered_set<std::uint64_t> taken;
+    std::vector<Entry>                added;
+    for (const Entry& entry : incoming)
+        if (!table.contains(entry.fingerprint) && taken.insert(entry.fingerprint).second)
+            added.push_back(entry);
+
+    if (!added.empty())
+        table.add(added);
+    return added.size();
+}
+
+void FingerprintStore::compact() const {
+    LockedTable table(path, true);
+    const std::vector<Entry> all = table.entries();
+    table.rebuild(capacity_for(all.size()), all, table.header().next_sequence);
+}
+
+bool FingerprintStore::is_store(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char          magic[sizeof(STORE_MAGIC)] = {};
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, STORE_MAGIC, sizeof(STORE_MAGIC)) == 0;
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fuznet {
+
+// The set of netlist fingerprints a campaign has seen, in one file that any
+// number of processes share. The file is an open-addressing hash table that
+// each operation maps into memory under an flock, so a lookup or insert
+// touches a few pages whatever the campaign's size, and check-and-insert is
+// atomic across processes.
+//
+// A table over half full is rebuilt at twice the size in a new file renamed
+// over the old one. A process that was waiting on the old file's lock sees
+// the path now names another file, and takes the new one's lock instead.
+//
+// Layout: a 64-byte header ("FZNSEEN", version, byte order, capacity, count,
+// next sequence number), then `capacity` 16-byte slots. A slot holds a
+// fingerprint, the order it was added in (0 for an empty slot) and when.
+class FingerprintStore {
+public:
+    static constexpr std::uint32_t VERSION      = 2;  // 1 held fingerprints blind to IO buffer kinds
+    static constexpr std::uint64_t MIN_CAPACITY = 1024;
+
+    struct Entry {
+        std::uint64_t fingerprint;
+        std::uint32_t sequence;  // 1 for the first added
+        std::uint32_t added;     // Unix time
+    };
+
+    explicit FingerprintStore(std::string path);
+
+    // Adds `fingerprint` unless the store has it; true if it was added. The
+    // file is created on first insert.
+    bool insert(std::uint64_t fingerprint) const;
+    bool contains(std::uint64_t fingerprint) const;
+
+    // Every entry, in the order added
+    std::vector<Entry> entries() const;
+
+    // Adds what another store at `source` has and this one does not, keeping
+    // when it was first added. Returns how many were new.
+    std::size_t merge(const std::string& source) const;
+
+    // Rebuilds the table at the smallest size for its entries
+    void compact() const;
+
+    static bool is_store(const std::string& path);
+
+private:
+    std::string path;
+};
+
+}
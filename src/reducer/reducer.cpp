@@ -1,43 +1,148 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <unordered_set>
+#include <vector>
 
 #include "reducer.hpp"
+#include "fingerprint_store.hpp"
+#include "structural_hash.hpp"
 
 
 namespace fuznet {
 
+namespace {
+
+using Chunks = std::vector<std::vector<int>>;
+
+// Ids of the modules other than IO buffers, by the depth of their fan-in
+// cone, deepest first: outputs-first topological order, and a run of it is
+// a band of the design at one depth. Depth stands in for cone size, which
+// would take a search per module; one post-order pass finds every depth,
+// ignoring the edges that close a loop.
+std::vector<int> removal_order(const CompactNetlist& netlist) {
+    using Index = CompactNetlist::Index;
+    const auto modules = static_cast<Index>(netlist.module_count());
+
+    enum : std::uint8_t { UNVISITED, OPEN, DONE };
+    std::vector<std::uint8_t>            state(modules, UNVISITED);
+    std::vector<std::size_t>             depth(modules, 0);
+    std::vector<std::pair<Index, Index>> stack;  // module, next input pin
+    for (Index root = 0; root < modules; ++root) {
+        if (state[root] != UNVISITED) continue;
+        state[root] = OPEN;
+        stack.emplace_back(root, netlist.first_pin(root));
+        while (!stack.empty()) {
+            auto& [at, pin] = stack.back();
+            if (pin == netlist.first_pin(at) + netlist.module_spec(at).input_bits) {
+                state[at] = DONE;
+                stack.pop_back();
+                continue;
+            }
+            const Index net = netlist.pin_net(pin++);
+            if (net == CompactNetlist::NONE || netlist.driver(net) == CompactNetlist::NONE) continue;
+            const Index source = netlist.pin_module(netlist.driver(net));
+            if (state[source] == UNVISITED) {
+                state[source] = OPEN;
+                --pin;  // back to this pin once `source` is done
+                stack.emplace_back(source, netlist.first_pin(source));
+            } else if (state[source] == DONE) {
+                depth[at] = std::max(depth[at], depth[source] + 1);
+            }
+        }
+    }
+
+    std::vector<std::pair<std::size_t, int>> by_depth;
+    for (Index m = 0; m < modules; ++m)
+        if (!netlist.module_spec(m).is_buffer())
+            by_depth.emplace_back(depth[m], netlist.module_id(m));
+
+    std::sort(by_depth.begin(), by_depth.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    std::vector<int> order;
+    order.reserve(by_depth.size());
+    for (const auto& entry : by_depth) order.push_back(entry.second);
+    return order;
+}
+
+// `ids` in `parts` runs, their sizes differing by at most one
+Chunks split(const std::vector<int>& ids, std::size_t parts) {
+    parts = std::max<std::size_t>(1, std::min(parts, ids.size()));
+    Chunks      result;
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < parts; ++i) {
+        const std::size_t end = begin + (ids.size() - begin) / (parts - i);
+        result.emplace_back(ids.begin() + begin, ids.begin() + end);
+        begin = end;
+    }
+    return result;
+}
+
+// Each chunk in two
+Chunks halve(const Chunks& chunks) {
+    Chunks result;
+    for (const auto& chunk : chunks)
+        for (auto& half : split(chunk, 2))
+            result.push_back(std::move(half));
+    return result;
+}
+
+}
+
 Reducer::Reducer(const std::string& lib_yaml,
-                 const std::string& input_json,
+                 const std::string& input_file,
                  const std::string& hash_file,
                  unsigned seed,
                  bool json_stats,
-                 bool verbose)
+                 bool verbose,
+                 bool snapshot,
+                 bool ddmin)
      : hash_file(hash_file),
        rng(seed),
-       library(lib_yaml, rng), 
-       netlist(library, rng),
+       library(std::make_shared<const Library>(lib_yaml)), 
+       netlist(*library, rng),
        json_stats(json_stats),
-       verbose(verbose)
+       verbose(verbose),
+       snapshot(snapshot),
+       ddmin(ddmin)
 {
-    std::ifstream json_file(input_json);
-    if (!json_file.is_open()) {
-        std::cerr << "Error: Could not open input JSON file: " << input_json << "\n";
-        throw std::runtime_error("Failed to open input JSON file");
+    if (!std::filesystem::exists(input_file)) {
+        std::cerr << "Error: Could not open input netlist file: " << input_file << "\n";
+        throw std::runtime_error("Failed to open input netlist file");
     }
-    
-    json_file >> json_data;
-    json_file.close();
+
+    state = NetlistFile::load(input_file, *library);
 }
 
+Reducer::Reducer(std::shared_ptr<const Library> library,
+                 NetlistFile state,
+                 const std::string& hash_file,
+                 unsigned seed,
+                 bool json_stats,
+                 bool verbose,
+                 bool snapshot,
+                 bool ddmin)
+     : hash_file(hash_file),
+       rng(seed),
+       library(std::move(library)),
+       netlist(*this->library, rng),
+       state(std::move(state)),
+       json_stats(json_stats),
+       verbose(verbose),
+       snapshot(snapshot),
+       ddmin(ddmin)
+{}
+
 Result Reducer::reduce(const int& output_id, bool success, bool reset) {
     if (verbose)
         std::cout << "Starting reduction process.\n";
 
-    int iterations = json_data.value("iterations", 0);
-    json_data["iterations"] = iterations + 1;
+    int iterations = state.meta.value("iterations", 0);
+    state.meta["iterations"] = iterations + 1;
 
     if (iterations == 0)
-        json_data["old"] = json_data["new"];
+        state.previous = state.current;
 
     if (output_id >= 0 && iterations == 0) {
         keep_only_net(output_id);
@@ -47,14 +152,15 @@ Result Reducer::reduce(const int& output_id, bool success, bool reset) {
     if (verbose)
         std::cout << "Iterative reduction started with last success: " << success << " and reset: " << reset << "\n";
     
-    return iterative_reduce(success, reset);
+    return ddmin ? ddmin_reduce(success, reset) : iterative_reduce(success, reset);
 }
     
 void Reducer::keep_only_net(const int& output_id) {
     if (verbose)
         std::cout << "Reducing netlist to keep only net with ID: " << output_id << "\n";
 
-    netlist.load_from_json(json_data["new"]);
+    if (!live)
+        netlist.load(state.current);
 
     if (verbose) {
         std::cout << "Netlist has:" << "\n";
@@ -68,33 +174,42 @@ void Reducer::keep_only_net(const int& output_id) {
         netlist.print();
     }
 
-    json_data["new"] = netlist.json();
+    state.current = netlist.compact();
+    live          = true;
 }
 
-Result Reducer::iterative_reduce(bool success, bool reset) {
-    if (verbose)
-        std::cout << "Starting iterative reduction of the netlist.\n";
-
-    if (reset)
-        json_data["tried_to_remove_net_ids"] = nlohmann::json::array();
-
+void Reducer::resume(bool success) {
     if (success) {
         if (verbose)
             std::cout << "Reducer initialized with last reduction success.\n";
-        netlist.load_from_json(json_data["new"]);
-        json_data["old"] = json_data["new"];
+        if (!live)
+            netlist.load(state.current);
+        state.previous = state.current;
     } else {
         if (verbose)
             std::cout << "Reducer initialized with last reduction failure.\n";
-        netlist.load_from_json(json_data["old"]);
+        if (!state.previous)
+            throw std::runtime_error("No previous netlist to fall back to");
+        netlist.load(*state.previous);
+        live = false;
     }
 
     if (verbose) {
         std::cout << "Netlist has:" << "\n";
         netlist.print();
     }
+}
+
+Result Reducer::iterative_reduce(bool success, bool reset) {
+    if (verbose)
+        std::cout << "Starting iterative reduction of the netlist.\n";
 
-    std::set<int> tried_to_remove_net_ids = json_data.value(
+    if (reset)
+        state.meta["tried_to_remove_net_ids"] = nlohmann::json::array();
+
+    resume(success);
+
+    std::set<int> tried_to_remove_net_ids = state.meta.value(
         "tried_to_remove_net_ids", nlohmann::json::array()
     ).get<std::set<int>>();
 
@@ -117,33 +232,141 @@ Result Reducer::iterative_reduce(bool success, bool reset) {
     netlist.remove_duplicate_outputs();
     netlist.remove_input_output_chains();
 
-    json_data["new"] = netlist.json();
+    state.current = netlist.compact();
+    live          = true;
 
-    json_data["tried_to_remove_net_ids"] = nlohmann::json::array();
+    state.meta["tried_to_remove_net_ids"] = nlohmann::json::array();
     for (const auto& id : tried_to_remove_net_ids)
-        json_data["tried_to_remove_net_ids"].push_back(id);
+        state.meta["tried_to_remove_net_ids"].push_back(id);
+
+    return Result::SUCCESS;
+}
+
+// Delta debugging over the modules of the last netlist that failed. They are
+// split into chunks in removal_order, and each step removes one chunk, which
+// tests the complement of it. A chunk whose removal still fails is gone for
+// good, and the next step goes on with the chunk after it (ddmin's reduce to
+// complement, granularity one less). A pass that removed a chunk is tried
+// again at the same size, since what failed before may go now. Only once a
+// whole pass removes nothing is each chunk halved, and the reduction ends
+// when a pass over single modules removes nothing, leaving a 1-minimal set.
+//
+// The partition is kept in meta "ddmin": "chunks" of module ids, "next" to
+// try, "trying", the chunk the current netlist lacks or -1, and
+// "removed_this_pass", whether the pass so far removed a chunk.
+Result Reducer::ddmin_reduce(bool success, bool reset) {
+    if (verbose)
+        std::cout << "Starting ddmin reduction of the netlist.\n";
+
+    if (reset)
+        state.meta.erase("ddmin");
+
+    resume(success);
+
+    // resume leaves the netlist it loaded in state.previous
+    const CompactNetlist&   loaded = *state.previous;
+    std::unordered_set<int> logic;  // ids of its modules other than IO buffers
+    for (CompactNetlist::Index m = 0; m < loaded.module_count(); ++m)
+        if (!loaded.module_spec(m).is_buffer())
+            logic.insert(loaded.module_id(m));
+
+    Chunks      chunks;
+    std::size_t next              = 0;
+    int         trying            = -1;
+    bool        removed_this_pass = false;
+    if (state.meta.contains("ddmin")) {
+        const nlohmann::json& saved = state.meta["ddmin"];
+        chunks            = saved.at("chunks").get<Chunks>();
+        next              = saved.value("next", std::size_t{0});
+        trying            = saved.value("trying", -1);
+        removed_this_pass = saved.value("removed_this_pass", false);
+    } else {
+        chunks = split(removal_order(loaded), 2);
+    }
+
+    if (trying >= 0 && static_cast<std::size_t>(trying) < chunks.size()) {
+        if (success) {
+            chunks.erase(chunks.begin() + trying);
+            removed_this_pass = true;
+        }
+        next = success ? trying : trying + 1;
+    }
+
+    int removed = 0;
+    while (removed == 0) {
+        if (next >= chunks.size()) {
+            const bool single = std::ranges::all_of(chunks, [](const auto& c) { return c.size() <= 1; });
+            if (!removed_this_pass && single) {
+                state.meta["ddmin"] = {{"chunks", chunks}, {"next", next}, {"trying", -1},
+                                       {"removed_this_pass", false}};
+                if (verbose)
+                    std::cout << "No more modules to remove.\n";
+                return check_hash();
+            }
+            if (!removed_this_pass)
+                chunks = halve(chunks);
+            next              = 0;
+            removed_this_pass = false;
+        }
+        // Never all of them at once
+        const auto present = std::ranges::count_if(chunks[next], [&](int id) { return logic.contains(id); });
+        if (static_cast<std::size_t>(present) == logic.size()) {
+            if (chunks[next].size() <= 1) {
+                ++next;
+                continue;
+            }
+            Chunks halves = split(chunks[next], 2);
+            chunks[next]  = std::move(halves[0]);
+            chunks.insert(chunks.begin() + next + 1, std::move(halves[1]));
+        }
+
+        removed = netlist.remove_modules(chunks[next]);
+        if (removed == 0)
+            chunks.erase(chunks.begin() + next);  // none left to remove
+    }
+
+    if (verbose)
+        std::cout << "Removed " << removed << " modules, chunk " << next + 1 << " of " << chunks.size()
+                  << " (" << chunks[next].size() << " ids)\n";
 
+    netlist.remove_duplicate_outputs();
+    netlist.remove_input_output_chains();
+
+    state.current = netlist.compact();
+    live          = true;
+
+    state.meta["ddmin"] = {{"chunks", chunks}, {"next", next}, {"trying", next},
+                           {"removed_this_pass", removed_this_pass}};
     return Result::SUCCESS;
 }
 
-void Reducer::write_outputs(const std::string& output) const {
+void Reducer::write_outputs(const std::string& output, unsigned outputs) const {
     if (verbose)
         std::cout << "Dumping netlist file to prefix: " << output << "\n";
 
-    std::ofstream json_file(output + ".json", std::ios::trunc);
-    json_file << std::setw(4) << json_data << std::endl;
-    json_file.close();
+    if (outputs & NETLIST_FILE) {
+        if (snapshot)
+            state.save_snapshot(output + ".fzn");
+        else
+            state.save_json(output + ".json");
+    }
     
-    int iterations = json_data.value("iterations", 0);
-    std::ofstream dot_file(output + "_iter" + std::to_string(iterations) + ".dot");
-    netlist.emit_dotfile(dot_file, "top");
-    dot_file.close();
+    const CompactNetlist view = netlist.compact();
+
+    if (outputs & DOTFILE) {
+        int iterations = state.meta.value("iterations", 0);
+        std::ofstream dot_file(output + "_iter" + std::to_string(iterations) + ".dot");
+        view.emit_dotfile(dot_file, "top");
+        dot_file.close();
+    }
     
-    std::ofstream verilog_file(output + ".v");
-    netlist.emit_verilog(verilog_file, "top");
-    verilog_file.close();
+    if (outputs & VERILOG) {
+        std::ofstream verilog_file(output + ".v");
+        view.emit_verilog(verilog_file, "top");
+        verilog_file.close();
+    }
     
-    if (!json_stats)
+    if (!json_stats || !(outputs & STATS))
         return;
 
     nlohmann::json json_data;
@@ -156,6 +379,7 @@ void Reducer::write_outputs(const std::string& output) const {
     json_data["comb_modules"] = stats.comb_modules;
     json_data["seq_modules"] = stats.seq_modules;
     json_data["total_modules"] = stats.total_modules;
+    json_data["fingerprint"] = fingerprint_text(structural_hash(view));
 
     std::ofstream json_stats(output + "_stats.json");
     json_stats << std::setw(4) << json_data << std::endl;
@@ -169,46 +393,14 @@ Result Reducer::check_hash() const {
     if (verbose)
         std::cout << "Checking hash for the current netlist.\n";
 
-    if (!std::filesystem::exists(hash_file)) {
-        std::ofstream new_hash_file(hash_file);
-        if (!new_hash_file.is_open()) {
-            std::cerr << "Error: Could not create hash file: " << hash_file << "\n";
-            return Result::FAILURE;
-        }
-        new_hash_file.close();
-    }
-    
-    std::ifstream hash_file_stream(hash_file);
-    if (!hash_file_stream.is_open()) {
-        std::cerr << "Error: Could not open hash file: " << hash_file << "\n";
-        return Result::FAILURE;
-    }
-
-    std::set<std::string> seen_hashes;
-    std::string line;
-    while (std::getline(hash_file_stream, line)) {
-        seen_hashes.insert(line);
-    }
-    hash_file_stream.close();
+    const std::uint64_t fingerprint = netlist.get_fingerprint();
+    std::cout << "Current netlist fingerprint: " << fingerprint_text(fingerprint) << "\n";
 
-    int fingerprint = netlist.get_fingerprint();
-    std::string current_hash = std::to_string(fingerprint);
-
-    std::cout << "Current netlist fingerprint: " << current_hash << "\n";
-
-    if (seen_hashes.contains(current_hash)) {
+    if (!FingerprintStore(hash_file).insert(fingerprint)) {
         std::cout << "Netlist already seen\n";
         return Result::ALREADY_SEEN;
     }
 
-    std::ofstream hash_file_out(hash_file, std::ios::app);
-    if (!hash_file_out.is_open()) {
-        std::cerr << "Error: Could not open hash file for writing: " << hash_file << "\n";
-        return Result::FAILURE;
-    }
-    hash_file_out << current_hash << "\n";
-    hash_file_out.close();
-
     std::cout << "New netlist hash added to the file.\n";
     return Result::NEW_HASH_ADDED;
 }
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <nlohmann/json.hpp>
+#include <memory>
 #include <random>
 #include <string>
 #include <set>
 
 #include "netlist.hpp"
+#include "netlist_file.hpp"
 
 namespace fuznet {
 
@@ -16,34 +18,60 @@ enum class Result {
     NEW_HASH_ADDED
 };
 
+// What write_outputs writes, any combination
+enum Output : unsigned {
+    NETLIST_FILE = 1u << 0,  // <output>.json, or <output>.fzn with snapshot
+    DOTFILE      = 1u << 1,  // <output>_iter<N>.dot
+    VERILOG      = 1u << 2,  // <output>.v
+    STATS        = 1u << 3,  // <output>_stats.json, only with json_stats
+    ALL_OUTPUTS  = NETLIST_FILE | DOTFILE | VERILOG | STATS
+};
+
 class Reducer {
 public:
     Reducer(const std::string& lib_yaml      = "hardware/xilinx/cells.yaml",
-            const std::string& input_json    = "output/output_netlist.json",
-            const std::string& hash_file     = "output/seen_netlists.txt",
+            const std::string& input_file    = "output/output_netlist.json",
+            const std::string& hash_file     = "output/seen_netlists.db",
             unsigned           seed          = std::random_device{}(),
             bool               json_stats    = false,
-            bool               verbose       = false);
+            bool               verbose       = false,
+            bool               snapshot      = false,
+            bool               ddmin         = false);
+
+    // Reduces `state`, already in memory, with an already loaded library
+    Reducer(std::shared_ptr<const Library> library,
+            NetlistFile                    state,
+            const std::string&             hash_file,
+            unsigned                       seed,
+            bool                           json_stats = false,
+            bool                           verbose    = false,
+            bool                           snapshot   = false,
+            bool                           ddmin      = false);
 
-    void write_outputs(const std::string& output_json) const;
+    void write_outputs(const std::string& output_json, unsigned outputs = ALL_OUTPUTS) const;
     Result reduce(const int& output_id, bool success = true, bool reset = false);
     
 private:
     
+    void    resume(bool success);
     Result  iterative_reduce(bool success, bool reset);
+    Result  ddmin_reduce(bool success, bool reset);
     void    keep_only_net(const int& output_id);
     Result  check_hash() const;
 
     const std::string hash_file;
 
-    std::mt19937_64 rng;
-    Library library;
-    Netlist netlist;
+    std::mt19937_64                rng;
+    std::shared_ptr<const Library> library;
+    Netlist                        netlist;
 
-    nlohmann::json json_data;
+    NetlistFile state;
+    bool        live{false};  // netlist holds state.current, no need to load it
 
     bool json_stats{false};
     bool verbose{false};
+    bool snapshot{false};
+    bool ddmin{false};     // remove chunks of modules, see ddmin_reduce
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "server.hpp"
+#include "structural_hash.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace fuznet {
+
+namespace {
+
+// Lines from a file descriptor, without their line ending
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd(fd) {}
+
+    bool next(std::string& line) {
+        std::size_t newline;
+        while ((newline = buffer.find('\n')) == std::string::npos) {
+            char          chunk[4096];
+            const ssize_t got = ::read(fd, chunk, sizeof(chunk));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                if (buffer.empty()) return false;
+                line = std::exchange(buffer, {});  // last line, unterminated
+                return true;
+            }
+            buffer.append(chunk, static_cast<std::size_t>(got));
+        }
+        line = buffer.substr(0, newline);
+        buffer.erase(0, newline + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        return true;
+    }
+
+private:
+    int         fd;
+    std::string buffer;
+};
+
+bool write_all(int fd, const std::string& text) {
+    std::size_t done = 0;
+    while (done < text.size()) {
+        const ssize_t wrote = ::write(fd, text.data() + done, text.size() - done);
+        if (wrote < 0 && errno == EINTR) continue;
+        if (wrote <= 0) return false;
+        done += static_cast<std::size_t>(wrote);
+    }
+    return true;
+}
+
+std::vector<std::string> split_words(const std::string& line) {
+    std::istringstream       in(line);
+    std::vector<std::string> words;
+    for (std::string word; in >> word;)
+        words.push_back(word);
+    return words;
+}
+
+unsigned parse_unsigned(const std::string& word, const char* what) {
+    std::size_t used = 0;
+    unsigned long value = 0;
+    try {
+        value = std::stoul(word, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used != word.size() || word.starts_with('-') || value > 0xffffffffUL)
+        throw std::runtime_error(std::string("Bad ") + what + ": " + word);
+    return static_cast<unsigned>(value);
+}
+
+const char* result_name(Result result) {
+    switch (result) {
+        case Result::SUCCESS:        return "0 success";
+        case Result::FAILURE:        return "1 failure";
+        case Result::ALREADY_SEEN:   return "2 already_seen";
+        case Result::NEW_HASH_ADDED: return "3 new_hash_added";
+    }
+    return "1 failure";
+}
+
+}
+
+Server::Server(const std::string& lib_yaml,
+               const std::string& config_toml,
+               const std::string& hash_file,
+               unsigned           seed,
+               bool               verbose,
+               bool               json_stats,
+               bool               snapshot,
+               bool               ddmin)
+    : lib_yaml(lib_yaml),
+      config_toml(config_toml),
+      hash_file(hash_file),
+      seed(seed),
+      verbose(verbose),
+      json_stats(json_stats),
+      snapshot(snapshot),
+      ddmin(ddmin),
+      library(std::make_shared<const Library>(lib_yaml))
+{}
+
+bool Server::serve(int in_fd, int out_fd) {
+    LineReader  in(in_fd);
+    std::string line;
+    session_over = false;
+    while (!session_over && in.next(line)) {
+        const std::string reply = handle(line);
+        if (!reply.empty() && !write_all(out_fd, reply + "\n"))
+            break;  // nobody is reading the replies any more
+    }
+    return !stopping;
+}
+
+void Server::listen(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Socket path too long: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // Left behind by a server that did not stop cleanly
+    struct stat existing{};
+    if (::lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode))
+            throw std::runtime_error("Not a socket, will not replace: " + path);
+        ::unlink(path.c_str());
+    }
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+        throw std::runtime_error("Could not create socket: " + path);
+    if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, 4) != 0) {
+        ::close(listener);
+        throw std::runtime_error("Could not listen on socket: " + path);
+    }
+    if (verbose)
+        std::cout << "Serving on " << path << '\n' << std::flush;
+
+    bool running = true;
+    while (running) {
+        const int client = ::accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            ::close(listener);
+            ::unlink(path.c_str());
+            throw std::runtime_error("Could not accept on socket: " + path);
+        }
+        running = serve(client, client);
+        ::close(client);
+    }
+
+    ::close(listener);
+    ::unlink(path.c_str());
+}
+
+std::string Server::handle(const std::string& request) {
+    const std::vector<std::string> words = split_words(request);
+    if (words.empty() || words[0].starts_with('#'))
+        return {};
+
+    const std::string& verb = words[0];
+    auto expect = [&](std::size_t least, std::size_t most, const char* usage) {
+        if (words.size() < least + 1 || words.size() > most + 1)
+            throw std::runtime_error(std::string("Usage: ") + usage);
+    };
+    auto served = [&]() -> Reducer& {
+        if (!reducer)
+            throw std::runtime_error("Nothing served yet, load or generate a netlist first");
+        return *reducer;
+    };
+
+    try {
+        if (verb == "load") {
+            expect(1, 1, "load FILE");
+            return serve_file(NetlistFile::load(words[1], *library), seed);
+        }
+
+        if (verb == "generate") {
+            expect(2, 2, "generate PREFIX SEED");
+            const unsigned design_seed = parse_unsigned(words[2], "seed");
+            if (!generator)
+                generator = std::make_unique<Orchestrator>(library, lib_yaml, config_toml, design_seed,
+                                                           verbose, false, json_stats, snapshot);
+            generator->reseed(design_seed);
+
+            NetlistFile file;
+            file.current = generator->run(words[1]);
+            return serve_file(std::move(file), design_seed);
+        }
+
+        if (verb == "step") {
+            expect(0, 1, "step [NET]");
+            const int net = words.size() > 1 ? static_cast<int>(parse_unsigned(words[1], "net id")) : -1;
+            Reducer&  r   = served();
+
+            const Result result = r.reduce(net, std::exchange(accepted, false), std::exchange(reset_tried, false));
+            return std::string("ok ") + result_name(result);
+        }
+
+        if (verb == "accept" || verb == "reject") {
+            expect(0, 0, verb == "accept" ? "accept" : "reject");
+            served();
+            accepted = verb == "accept";
+            return "ok";
+        }
+
+        if (verb == "reset") {
+            expect(0, 0, "reset");
+            served();
+            reset_tried = true;
+            return "ok";
+        }
+
+        if (verb == "emit") {
+            expect(1, 5, "emit PREFIX [netlist|dot|verilog|stats]...");
+            unsigned outputs = words.size() > 2 ? 0u : ALL_OUTPUTS;
+            for (std::size_t i = 2; i < words.size(); ++i) {
+                if      (words[i] == "netlist") outputs |= NETLIST_FILE;
+                else if (words[i] == "dot")     outputs |= DOTFILE;
+                else if (words[i] == "verilog") outputs |= VERILOG;
+                else if (words[i] == "stats")   outputs |= STATS;
+                else throw std::runtime_error("Unknown output: " + words[i]);
+            }
+            served().write_outputs(words[1], outputs);
+            return "ok";
+        }
+
+        if (verb == "quit" || verb == "shutdown") {
+            expect(0, 0, verb == "quit" ? "quit" : "shutdown");
+            session_over = true;
+            stopping     = verb == "shutdown";
+            return "ok";
+        }
+
+        throw std::runtime_error("Unknown request: " + verb);
+    } catch (const std::exception& e) {
+        std::string message = e.what();
+        for (char& c : message)
+            if (c == '\n' || c == '\r') c = ' ';
+        return "error " + message;
+    }
+}
+
+std::string Server::serve_file(NetlistFile file, unsigned reducer_seed) {
+    const std::string reply = "ok " + std::to_string(file.current.module_count()) + " " +
+                              fingerprint_text(structural_hash(file.current));
+
+    reducer.emplace(library, std::move(file), hash_file, reducer_seed, json_stats, verbose, snapshot, ddmin);
+    accepted    = false;
+    reset_tried = false;
+    return reply;
+}
+
+}
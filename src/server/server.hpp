@@ -0,0 +1,94 @@
+#pragma once
+
+#include "library.hpp"
+#include "orchestrator.hpp"
+#include "reducer.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace fuznet {
+
+// `fuznet serve`: generate and reduce on request, keeping the library, the
+// generator and the netlist being reduced in memory between requests, so a
+// driver pays for parsing cells.yaml and the netlist file once rather than
+// once per reduction step.
+//
+// Requests and replies are lines of words separated by spaces. Each request
+// gets one reply line, "ok" and its results or "error" and a message, and
+// nothing else is written where replies go. Empty lines and lines starting
+// with '#' are skipped without a reply.
+//
+//   load FILE              serve FILE, JSON or .fzn, as reduce -i would read
+//                          it                          -> ok MODULES FINGERPRINT
+//   generate PREFIX SEED   write what -s SEED generate -o PREFIX would, and
+//                          serve the result            -> ok MODULES FINGERPRINT
+//   step [NET]             one reduce step on what is served, the first
+//                          keeping only output net NET as reduce -r NET
+//                                                      -> ok CODE RESULT
+//   accept                 the last step's netlist still shows the bug: the
+//                          next step reduces it further, as --last-success
+//   reject                 it does not: the next step goes back to the last
+//                          netlist accepted. The default after each step.
+//   reset                  the next step may remove modules tried before,
+//                          as --reset
+//   emit PREFIX [KIND...]  write what reduce -o PREFIX would; KINDs among
+//                          netlist, dot, verilog and stats write only those
+//   quit                   end this session
+//   shutdown               end this session and stop serving
+//
+// CODE and RESULT are what reduce exits with and means by it: 0 success,
+// 2 already_seen, 3 new_hash_added. MODULES counts the IO buffers too, and
+// FINGERPRINT is as `fuznet fingerprint` prints it. accept, reject, reset,
+// emit, quit and shutdown reply a bare "ok".
+//
+// A step keeps its random stream going from the last, where repeated reduce
+// runs each start from -s, so the modules a served reduction removes differ
+// from what the same run of reduce processes would remove.
+class Server {
+public:
+    Server(const std::string& lib_yaml,
+           const std::string& config_toml,
+           const std::string& hash_file,
+           unsigned           seed,
+           bool               verbose    = false,
+           bool               json_stats = false,
+           bool               snapshot   = false,
+           bool               ddmin      = false);
+
+    // Answers the requests read from `in_fd` on `out_fd` until quit,
+    // shutdown or the end of input. False once shutdown was requested.
+    bool serve(int in_fd, int out_fd);
+
+    // Serves the clients of a Unix socket bound at `path`, one at a time and
+    // all on the same state, until one requests shutdown
+    void listen(const std::string& path);
+
+    // The reply to `request`, without its newline; empty for a line that
+    // gets none
+    std::string handle(const std::string& request);
+
+private:
+    std::string serve_file(NetlistFile file, unsigned reducer_seed);
+
+    std::string lib_yaml;
+    std::string config_toml;
+    std::string hash_file;
+    unsigned    seed;
+    bool        verbose;
+    bool        json_stats;
+    bool        snapshot;
+    bool        ddmin;
+
+    std::shared_ptr<const Library> library;
+    std::unique_ptr<Orchestrator>  generator;  // made on the first generate
+    std::optional<Reducer>         reducer;    // what is served, if anything
+
+    bool accepted     = false;
+    bool reset_tried  = false;
+    bool session_over = false;
+    bool stopping     = false;
+};
+
+}